@@ -0,0 +1,107 @@
+#!/bin/sh
+# Compila la librería con todas las combinaciones válidas de JWMB_ENABLE_* en
+# tres perfiles: host (sin ARDUINO, backend Linux), Arduino (stub) y ESP32
+# (stub + FreeRTOS). Con -Wall -Wextra -Werror: un warning es un fallo.
+#
+# Uso:  sh extras/test/check_flags.sh        (o "make flags" en extras/test)
+#       CXX=clang++ sh extras/test/check_flags.sh
+#
+# JWMatrixButtons.cpp (donde viven casi todos los #if) recorre la matriz
+# completa; el resto de .cpp solo depende de los flags en sus cabeceras, así que
+# se compila con todo activado y con todo desactivado. JWMatrixExpander.cpp se
+# compila además con JWMB_ENABLE_EXPANDER (y _SPI) activos, y
+# JWMatrixTopology.cpp con los dos estilos de registro de puerto de los cores.
+# Al final, un sketch con flags distintos a los de la librería no debe enlazar.
+
+cd "$(dirname "$0")/../.." || exit 1
+CXX=${CXX:-g++}
+CXXFLAGS="-std=gnu++11 -Wall -Wextra -Werror -fsyntax-only -Isrc"
+STUB="-Iextras/test/stub -DARDUINO=10819"
+FLAGS="REPEAT LATCHES EVENT_LOG AXIS THREAD_SAFE PRIORITY SCAN_GROUPS ENCODER DIAGNOSTICS"
+NF=9
+
+fail=0
+count=0
+
+build()
+{
+  # $1 = flags del perfil, $2 = archivo, resto = defines
+  bp=$1; file=$2; shift 2
+  count=$((count + 1))
+  if ! $CXX $CXXFLAGS $bp "$@" "$file" 2>/tmp/jwmb_flags.err; then
+    echo "FALLA: $file $bp $*"
+    head -20 /tmp/jwmb_flags.err
+    fail=1
+  fi
+}
+
+defines()
+{
+  # $1 = máscara de bits (bit i = flag i de FLAGS)
+  out=""; i=0
+  for f in $FLAGS; do
+    out="$out -DJWMB_ENABLE_$f=$(( ($1 >> i) & 1 ))"
+    i=$((i + 1))
+  done
+  echo "$out"
+}
+
+for prof in "host" "arduino" "esp32"; do
+  case $prof in
+    host)    P="" ;;
+    arduino) P="$STUB" ;;
+    esp32)   P="$STUB -DARDUINO_ARCH_ESP32" ;;
+  esac
+  m=0
+  while [ $m -lt $((1 << NF)) ]; do
+    # AXIS (bit 3) sin LATCHES (bit 1) es un #error intencional
+    if [ $(( (m >> 3) & 1 )) -eq 1 ] && [ $(( (m >> 1) & 1 )) -eq 0 ]; then
+      m=$((m + 1)); continue
+    fi
+    build "$P" src/JWMatrixButtons.cpp $(defines $m)
+    m=$((m + 1))
+  done
+  for all in 0 $(( (1 << NF) - 1 )); do
+    for f in src/*.cpp; do
+      [ "$f" = src/JWMatrixButtons.cpp ] && continue
+      build "$P" "$f" $(defines $all)
+    done
+  done
+  # Backend de expansor: I2C solo, I2C + SPI
+  for ex in "-DJWMB_ENABLE_EXPANDER=1" \
+            "-DJWMB_ENABLE_EXPANDER=1 -DJWMB_ENABLE_EXPANDER_SPI=1"; do
+    build "$P" src/JWMatrixExpander.cpp $ex
+  done
+  echo "$prof: $count compilaciones"
+done
+
+# Registros de puerto: índice (AVR & co.) y puntero a struct (STM32duino)
+for port in "-DJWMB_TEST_PORT_READ" "-DJWMB_TEST_PORT_PTR"; do
+  build "$STUB $port" src/JWMatrixTopology.cpp
+done
+
+# Sin millis()/delay() globales fuera de Arduino (convive con wiringPi & co.)
+build "" extras/test/platform_clash.cpp
+
+# Flags distintos entre sketch y librería: el link tiene que fallar (con los
+# mismos, enlazar). Librería con los valores por defecto, host.
+LINKDIR=$(mktemp -d)
+LIBOBJ=""
+for f in src/JWMatrixButtons.cpp src/JWMatrixBackend.cpp; do
+  o="$LINKDIR/$(basename "$f" .cpp).o"
+  $CXX -std=gnu++11 -Isrc -c "$f" -o "$o" || fail=1
+  LIBOBJ="$LIBOBJ $o"
+done
+if ! $CXX -std=gnu++11 -Isrc extras/test/flags_link.cpp $LIBOBJ -o "$LINKDIR/same" -pthread 2>/dev/null; then
+  echo "FALLA: flags_link.cpp no enlaza con los mismos flags"
+  fail=1
+fi
+if $CXX -std=gnu++11 -Isrc -DJWMB_ENABLE_REPEAT=0 extras/test/flags_link.cpp $LIBOBJ -o "$LINKDIR/diff" -pthread 2>/dev/null; then
+  echo "FALLA: flags_link.cpp enlaza con flags distintos a los de la librería"
+  fail=1
+fi
+rm -rf "$LINKDIR"
+count=$((count + 4))
+
+[ $fail -eq 0 ] && echo "check_flags: OK ($count compilaciones)"
+exit $fail
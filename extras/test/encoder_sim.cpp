@@ -0,0 +1,169 @@
+// Encoders con Arduino simulado: detents lentos/rápidos, rebotes, y que un
+// giro rápido no pierda detents entre applyAxis() (se acumulan por encoder,
+// no en la cola de repeats de 8).
+//
+// Se compila dos veces: con y sin JWMB_ENABLE_REPEAT (sin repeat cada detent
+// es ±1).
+//
+// Compilar/ejecutar: make encoder (en extras/test)
+
+#include "JWMatrixButtons.h"
+#include "sim_arduino.h"
+
+static const uint8_t ROWS[] = {20};
+static const uint8_t COLS[] = {30, 31};
+static const JWMatrixButtons::BtnMapItem MAP[] = {{0, 0, 0}, {1, 0, 1}};
+static const uint8_t DEC = 2;
+static const uint8_t INC = 3;
+static const uint8_t PIN_A = 40;
+static const uint8_t PIN_B = 41;
+
+static JWMatrixButtons b;
+static int32_t logSum = 0; // suma de mult de los EV_DETENT del log (con signo)
+static uint32_t logEvents = 0;
+
+static void update()
+{
+  b.update();
+  for (uint8_t i = 0; i < b.eventCount(); i++)
+  {
+    JWMatrixButtons::BtnEvent e;
+    if (!b.getEvent(i, e) || e.type != JWMatrixButtons::EV_DETENT)
+      continue;
+    logEvents++;
+    logSum += (e.id == INC) ? e.mult : -e.mult;
+  }
+}
+
+static void stepMs(uint32_t ms)
+{
+  for (uint32_t i = 0; i < ms; i++)
+  {
+    update();
+    sim::advanceMs(1);
+  }
+}
+
+// Un detent completo de cuadratura (A = bit 0, B = bit 1)
+static const uint8_t CW[4] = {1, 0, 2, 3};
+static const uint8_t CCW[4] = {2, 0, 1, 3};
+
+static void detentPins(int dir, uint32_t msPerPhase, bool bounce = false)
+{
+  for (int k = 0; k < 4; k++)
+  {
+    uint8_t ab = (dir > 0) ? CW[k] : CCW[k];
+    sim::level[PIN_A] = ab & 1;
+    sim::level[PIN_B] = (ab >> 1) & 1;
+    stepMs(msPerPhase);
+    if (bounce && k == 1)
+    {
+      // rebote de contacto: vuelve a la fase anterior y regresa
+      uint8_t prev = (dir > 0) ? CW[0] : CCW[0];
+      sim::level[PIN_A] = prev & 1;
+      sim::level[PIN_B] = (prev >> 1) & 1;
+      stepMs(1);
+      sim::level[PIN_A] = ab & 1;
+      sim::level[PIN_B] = (ab >> 1) & 1;
+      stepMs(1);
+    }
+  }
+}
+
+static void detentFeed(uint8_t ch, int dir)
+{
+  for (int k = 0; k < 4; k++)
+  {
+    uint8_t ab = (dir > 0) ? CW[k] : CCW[k];
+    b.encoderInput(ch, ab & 1, (ab >> 1) & 1);
+  }
+}
+
+int main()
+{
+  sim::reset();
+  sim::level[PIN_A] = HIGH;
+  sim::level[PIN_B] = HIGH;
+
+  CHECK(b.begin(ROWS, 1, COLS, 2, MAP, 2, 4, false, 20));
+  CHECK(b.addEncoder(PIN_A, PIN_B, DEC, INC));
+  CHECK(!b.addEncoder(PIN_A, PIN_B, DEC, DEC));
+  CHECK(!b.addEncoder(PIN_A, PIN_B, DEC, INC, true)); // ISR solo en ESP32
+
+  // Lento: +1 por detent; un rebote a mitad no agrega detents
+  uint32_t v = 100;
+  for (int i = 0; i < 5; i++)
+  {
+    detentPins(1, 5, i == 2);
+    stepMs(300);
+  }
+  b.applyAxis(&v, 0, 99999, DEC, INC);
+  CHECK(v == 105);
+  detentPins(-1, 5);
+  stepMs(300);
+  b.applyAxis(&v, 0, 99999, DEC, INC);
+  CHECK(v == 104);
+
+  // Canal sin pines (encoderInput) para las ráfagas
+  CHECK(b.addEncoder(JWMatrixButtons::ENC_NO_PIN, JWMatrixButtons::ENC_NO_PIN, DEC, INC));
+
+  // 40 detents en un solo frame: un EV_DETENT y se aplican los 40
+  logEvents = 0;
+  logSum = 0;
+  for (int i = 0; i < 40; i++)
+    detentFeed(1, 1);
+  stepMs(1);
+  CHECK(logEvents == 1);
+  CHECK(logSum == 40); // tras pausa arranca en paso s1 = 1
+  v = 1000;
+  b.applyAxis(&v, 0, 99999, DEC, INC);
+  CHECK(v == 1040);
+
+  // Giro rápido sostenido sin applyAxis de por medio: 30 frames de 3 detents
+  // cada 2 ms (acelera a pasos grandes). Nada se pierde: el valor avanza lo
+  // mismo que suma el log (desde un múltiplo de 1000, el snap no mueve nada).
+  stepMs(400);
+  logEvents = 0;
+  logSum = 0;
+  for (int f = 0; f < 30; f++)
+  {
+    for (int i = 0; i < 3; i++)
+      detentFeed(1, 1);
+    stepMs(2);
+  }
+  CHECK(logEvents == 30);
+  v = 1000000;
+  b.applyAxis(&v, 0, 100000000, DEC, INC);
+#if JWMB_ENABLE_REPEAT
+  CHECK(logSum > 90); // aceleró
+  CHECK(v == 1000000u + (uint32_t)logSum);
+#else
+  CHECK(v == 1000000u + 90u); // sin repeat: ±1 por detent
+#endif
+
+  // Igual hacia abajo y saturando en el tope (sin wrap: sin repeat los
+  // detents son presses y harían wrap)
+  stepMs(400);
+  for (int f = 0; f < 30; f++)
+  {
+    for (int i = 0; i < 3; i++)
+      detentFeed(1, -1);
+    stepMs(2);
+  }
+  v = 50;
+  b.applyAxis(&v, 10, 99999, DEC, INC, false);
+  CHECK(v == 10);
+
+  // Nada pendiente tras consumir; clearEncoders() corta los detents
+  uint32_t v2 = v;
+  b.applyAxis(&v, 10, 99999, DEC, INC);
+  CHECK(v == v2);
+  b.clearEncoders();
+  detentPins(1, 5);
+  stepMs(5);
+  b.applyAxis(&v, 10, 99999, DEC, INC);
+  CHECK(v == v2);
+
+  printf("encoder_sim (repeat=%d): OK\n", JWMB_ENABLE_REPEAT);
+  return 0;
+}
@@ -0,0 +1,487 @@
+// Expansor simulado a nivel de bus + benchmark de JWMatrixExpander.
+//
+// - TwoWire simulado: MCP23017 (registros, puntero con auto-incremento) o
+//   PCF8574 (un puerto cuasi-bidireccional).
+// - SPIClass simulado: MCP23S17 (opcode + registro, frames delimitados por CS,
+//   dirección A2..A0 solo con IOCON.HAEN).
+// - Matriz 4x4: filas = bits 0..3 del puerto A (PCF8574: bits 0..3), columnas
+//   = bits 0..3 del puerto B (PCF8574: bits 4..7). Filas activas en LOW.
+//
+// Por cada chip mide transacciones por update() en reposo y con una tecla, y
+// comprueba que con settle > 0 el delay del núcleo cae entre la escritura de
+// la fila y la lectura de columnas. Con INT, además, que una lectura parcial
+// (updatePriority() o un grupo de escaneo) no haga perder una tecla de la
+// misma fila.
+//
+// Compilar/ejecutar: make expander (en extras/test)
+
+#include "JWMatrixButtons.h"
+#include "JWMatrixExpander.h"
+#include "sim_arduino.h"
+
+#include <string.h>
+
+static const uint8_t INT_PIN = 50;
+static const uint8_t CS_PIN = 10;
+static const uint8_t SPI_HW_ADDR = 3; // pines A2..A0 del MCP23S17 simulado
+
+// =========================
+// Chip simulado
+// =========================
+enum SimChip
+{
+  SIM_MCP23017,
+  SIM_PCF8574,
+  SIM_MCP23S17
+};
+
+struct FakeExpander
+{
+  SimChip chip = SIM_MCP23017;
+  bool keys[4][4] = {};   // [fila][col]
+  uint8_t reg[0x16] = {}; // MCP23x17, IOCON.BANK = 0
+  uint8_t ptr = 0;
+  uint8_t pcfOut = 0xFF;
+  uint8_t lastB = 0xFF;   // GPIOB en la última lectura (para INT)
+  uint32_t bus = 0;       // transacciones I2C / frames SPI vistos
+  uint64_t rowWrittenUs = 0;
+  uint64_t minSettleUs = ~0ull; // menor tiempo fila escrita -> columnas leídas
+
+  // SPI: estado del frame en curso
+  bool csLow = false;
+  uint8_t spiByte = 0;
+  bool spiRead = false;
+  bool spiSelected = false;
+};
+
+static FakeExpander fx;
+
+static void resetChip(SimChip chip)
+{
+  fx = FakeExpander();
+  fx.chip = chip;
+  fx.reg[0x00] = 0xFF; // IODIRA: todo entrada al encender
+  fx.reg[0x01] = 0xFF;
+}
+
+// Columnas (bits 0..3) según filas activas (LOW) y teclas
+static uint8_t colsLow(uint8_t rowsOut, uint8_t rowsDriven)
+{
+  uint8_t low = 0;
+  for (int r = 0; r < 4; r++)
+  {
+    bool active = ((rowsDriven >> r) & 1) && !((rowsOut >> r) & 1);
+    if (!active)
+      continue;
+    for (int c = 0; c < 4; c++)
+    {
+      if (fx.keys[r][c])
+        low |= (uint8_t)(1u << c);
+    }
+  }
+  return low;
+}
+
+static uint8_t mcpGpioB()
+{
+  uint8_t rowsDriven = (uint8_t)~fx.reg[0x00];
+  return (uint8_t)(0xFF & ~colsLow(fx.reg[0x12], rowsDriven));
+}
+
+static void sampleCols()
+{
+  uint64_t dt = sim::nowUs - fx.rowWrittenUs;
+  if (dt < fx.minSettleUs)
+    fx.minSettleUs = dt;
+}
+
+static uint8_t mcpRead(uint8_t r)
+{
+  if (r == 0x13)
+  {
+    sampleCols();
+    fx.lastB = mcpGpioB();
+    return fx.lastB;
+  }
+  return r < sizeof(fx.reg) ? fx.reg[r] : 0;
+}
+
+static void mcpWrite(uint8_t r, uint8_t v)
+{
+  if (r >= sizeof(fx.reg))
+    return;
+  fx.reg[r] = v;
+  if (r == 0x12)
+    fx.rowWrittenUs = sim::nowUs;
+}
+
+// INT (activo en LOW, INTA/INTB unidos): columnas distintas a la última lectura
+static int readPin(uint8_t pin)
+{
+  if (pin != INT_PIN)
+    return -1;
+  if (fx.chip == SIM_PCF8574)
+  {
+    // Como el MCP: por cambio respecto a la última lectura (columnas, bits 4..7)
+    uint8_t low = colsLow(fx.pcfOut, 0x0F);
+    uint8_t port = (uint8_t)(fx.pcfOut & ~(low << 4));
+    return ((port ^ fx.lastB) & 0xF0) ? LOW : HIGH;
+  }
+  bool changed = (fx.reg[0x05] & (mcpGpioB() ^ fx.lastB)) != 0;
+  return changed ? LOW : HIGH;
+}
+
+// =========================
+// Wire simulado
+// =========================
+TwoWire Wire;
+static uint8_t txBuf[8];
+static uint8_t txN = 0;
+static uint8_t rxBuf[8];
+static uint8_t rxN = 0;
+static uint8_t rxI = 0;
+
+void TwoWire::begin()
+{
+}
+
+void TwoWire::beginTransmission(uint8_t addr)
+{
+  (void)addr;
+  txN = 0;
+}
+
+size_t TwoWire::write(uint8_t v)
+{
+  CHECK(txN < sizeof(txBuf));
+  txBuf[txN++] = v;
+  return 1;
+}
+
+uint8_t TwoWire::endTransmission(bool stop)
+{
+  (void)stop;
+  fx.bus++;
+  if (fx.chip == SIM_PCF8574)
+  {
+    if (txN)
+    {
+      fx.pcfOut = txBuf[txN - 1];
+      fx.rowWrittenUs = sim::nowUs;
+    }
+    return 0;
+  }
+  fx.ptr = txBuf[0];
+  for (uint8_t i = 1; i < txN; i++)
+    mcpWrite(fx.ptr++, txBuf[i]);
+  return 0;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t addr, uint8_t n)
+{
+  (void)addr;
+  // MCP23017: repeated start dentro de la misma transacción
+  if (fx.chip == SIM_PCF8574)
+    fx.bus++;
+  rxN = n;
+  rxI = 0;
+  for (uint8_t i = 0; i < n; i++)
+  {
+    if (fx.chip == SIM_PCF8574)
+    {
+      // Cuasi-bidireccional: un pin en 1 lo baja la tecla de una fila en 0
+      sampleCols();
+      uint8_t low = colsLow(fx.pcfOut, 0x0F);
+      rxBuf[i] = (uint8_t)(fx.pcfOut & ~(low << 4));
+      fx.lastB = rxBuf[i];
+    }
+    else
+    {
+      rxBuf[i] = mcpRead(fx.ptr++);
+    }
+  }
+  return n;
+}
+
+int TwoWire::available()
+{
+  return rxN - rxI;
+}
+
+int TwoWire::read()
+{
+  return rxBuf[rxI++];
+}
+
+// =========================
+// SPI simulado (MCP23S17)
+// =========================
+SPIClass SPI;
+
+static void csHook(uint8_t pin, uint8_t v)
+{
+  if (pin != CS_PIN)
+    return;
+  if (v == LOW)
+  {
+    fx.csLow = true;
+    fx.spiByte = 0;
+    fx.bus++;
+  }
+  else
+  {
+    fx.csLow = false;
+  }
+}
+
+void SPIClass::begin()
+{
+}
+
+void SPIClass::beginTransaction(SPISettings settings)
+{
+  (void)settings;
+}
+
+uint8_t SPIClass::transfer(uint8_t v)
+{
+  CHECK(fx.csLow);
+  uint8_t out = 0;
+  uint8_t n = fx.spiByte++;
+  if (n == 0)
+  {
+    CHECK((v & 0xF0) == 0x40);
+    uint8_t addr = (uint8_t)((v >> 1) & 0x07);
+    bool haen = (fx.reg[0x0A] & 0x08) != 0;
+    fx.spiSelected = haen ? (addr == SPI_HW_ADDR) : (addr == 0);
+    fx.spiRead = (v & 1) != 0;
+  }
+  else if (n == 1)
+  {
+    fx.ptr = v;
+  }
+  else if (fx.spiSelected)
+  {
+    if (fx.spiRead)
+      out = mcpRead(fx.ptr++);
+    else
+      mcpWrite(fx.ptr++, v);
+  }
+  return out;
+}
+
+void SPIClass::endTransaction()
+{
+}
+
+// =========================
+// Benchmark
+// =========================
+static const uint8_t ROWS[] = {0, 1, 2, 3};
+static const uint8_t COLS[] = {0, 1, 2, 3};
+static const uint8_t COLS_PCF[] = {4, 5, 6, 7};
+static const JWMatrixButtons::BtnMapItem MAP[] = {
+    {0, 0, 0}, {1, 1, 1}, {2, 2, 2}, {3, 3, 3}};
+
+static const char *chipName(SimChip c)
+{
+  return c == SIM_MCP23017 ? "MCP23017" : (c == SIM_PCF8574 ? "PCF8574" : "MCP23S17");
+}
+
+static void updateFor(JWMatrixButtons &b, int n)
+{
+  for (int i = 0; i < n; i++)
+  {
+    b.update();
+    sim::advanceMs(5);
+  }
+}
+
+static void run(SimChip chip, bool useInt, uint16_t settleUs)
+{
+  sim::reset();
+  sim::readHook = readPin;
+  sim::writeHook = csHook;
+  resetChip(chip);
+
+  JWMatrixExpander ex = (chip == SIM_MCP23S17)
+                            ? JWMatrixExpander(SPI, CS_PIN, SPI_HW_ADDR)
+                            : JWMatrixExpander(chip == SIM_PCF8574
+                                                   ? JWMatrixExpander::CHIP_PCF8574
+                                                   : JWMatrixExpander::CHIP_MCP23017);
+  if (useInt)
+    ex.setIntPin(INT_PIN);
+
+  JWMatrixButtons b;
+  b.setBackend(&ex);
+  b.setScanDelays(settleUs, 0);
+  CHECK(b.begin(ROWS, 4, chip == SIM_PCF8574 ? COLS_PCF : COLS, 4,
+                MAP, 4, 4, true, 20));
+  if (chip == SIM_MCP23S17)
+    CHECK(fx.reg[0x0A] & 0x08); // HAEN activo
+
+  // Reposo
+  fx.bus = 0;
+  updateFor(b, 100);
+  uint32_t idle = fx.bus;
+  if (useInt)
+    CHECK(idle <= 1); // solo armar todas las filas
+
+  // Tecla presionada
+  fx.keys[2][2] = true;
+  updateFor(b, 10);
+  CHECK(b.isDown(2) && b.pressed(2));
+  CHECK(!b.isDown(0) && !b.isDown(1) && !b.isDown(3));
+
+  fx.bus = 0;
+  fx.minSettleUs = ~0ull;
+  b.update();
+  uint32_t active = fx.bus;
+  if (settleUs)
+    CHECK(fx.minSettleUs >= settleUs);
+
+  fx.keys[2][2] = false;
+  updateFor(b, 10);
+  CHECK(!b.isDown(2) && b.released(2));
+
+  printf("%-8s int=%d settle=%3u us: reposo %3u tx/100 updates, %2u tx/update con tecla (%u por fila)\n",
+         chipName(chip), useInt ? 1 : 0, settleUs, idle, active, active / 4);
+}
+
+// Con INT: una tecla normal en la misma fila que una prioritaria.
+// updatePriority() lee esa fila (y limpia INT); la tecla normal no vuelve a
+// disparar INT porque su columna sigue activa, y aun así se tiene que ver.
+static const uint8_t PRIO_ID = 0;
+static const JWMatrixButtons::BtnMapItem MAP_PRIO[] = {
+    {PRIO_ID, 2, 0}, {1, 1, 1}, {2, 2, 2}, {3, 3, 3}};
+
+static void runPrioRow(SimChip chip)
+{
+  sim::reset();
+  sim::readHook = readPin;
+  sim::writeHook = csHook;
+  resetChip(chip);
+
+  JWMatrixExpander ex = (chip == SIM_MCP23S17)
+                            ? JWMatrixExpander(SPI, CS_PIN, SPI_HW_ADDR)
+                            : JWMatrixExpander(chip == SIM_PCF8574
+                                                   ? JWMatrixExpander::CHIP_PCF8574
+                                                   : JWMatrixExpander::CHIP_MCP23017);
+  ex.setIntPin(INT_PIN);
+
+  JWMatrixButtons b;
+  b.setBackend(&ex);
+  CHECK(b.begin(ROWS, 4, chip == SIM_PCF8574 ? COLS_PCF : COLS, 4,
+                MAP_PRIO, 4, 4, true, 20));
+  CHECK(b.setPriorityKey(PRIO_ID, true));
+
+  // update() cada 5 ms, updatePriority() cada 1 ms (como el task de ESP32)
+  for (int t = 0; t < 100; t++)
+  {
+    if (t % 5 == 0)
+      b.update();
+    else
+      b.updatePriority();
+    sim::advanceMs(1);
+  }
+
+  // Presionar justo antes de un updatePriority() (lee la fila antes que update())
+  fx.keys[2][2] = true;
+  bool seen = false;
+  for (int t = 1; t < 500 && !seen; t++)
+  {
+    if (t % 5 == 0)
+      b.update();
+    else
+      b.updatePriority();
+    seen = b.isDown(2);
+    sim::advanceMs(1);
+  }
+  CHECK(seen);
+  fx.keys[2][2] = false;
+
+  printf("%-8s int=1 tecla normal en fila prioritaria: ok\n", chipName(chip));
+}
+
+// Con INT y grupos de escaneo: tecla lenta (grupo 0, 20 ms) en la misma fila
+// que una rápida (grupo 1, 1 ms). La lectura del grupo rápido limpia INT; la
+// tecla lenta se tiene que ver presionándola en cualquier fase del grupo 0.
+static const JWMatrixButtons::BtnMapItem MAP_GRP[] = {
+    {0, 0, 0}, {1, 0, 1}, {2, 2, 2}, {3, 3, 3}};
+
+static void runGroups(SimChip chip)
+{
+  sim::reset();
+  sim::readHook = readPin;
+  sim::writeHook = csHook;
+  resetChip(chip);
+
+  JWMatrixExpander ex = (chip == SIM_MCP23S17)
+                            ? JWMatrixExpander(SPI, CS_PIN, SPI_HW_ADDR)
+                            : JWMatrixExpander(chip == SIM_PCF8574
+                                                   ? JWMatrixExpander::CHIP_PCF8574
+                                                   : JWMatrixExpander::CHIP_MCP23017);
+  ex.setIntPin(INT_PIN);
+
+  JWMatrixButtons b;
+  b.setBackend(&ex);
+  CHECK(b.begin(ROWS, 4, chip == SIM_PCF8574 ? COLS_PCF : COLS, 4,
+                MAP_GRP, 4, 4, true, 20));
+  CHECK(b.setScanGroup(0, 20, 20));
+  CHECK(b.setScanGroup(1, 1, 5));
+  CHECK(b.setKeyGroup(0, 1));
+
+  int missed = 0;
+  for (int phase = 0; phase < 20; phase++)
+  {
+    for (int t = 0; t < 100 + phase; t++)
+    {
+      b.update();
+      sim::advanceMs(1);
+    }
+    fx.bus = 0;
+
+    fx.keys[0][1] = true;
+    bool seen = false;
+    for (int t = 0; t < 150 && !seen; t++)
+    {
+      b.update();
+      seen = b.isDown(1);
+      sim::advanceMs(1);
+    }
+    missed += seen ? 0 : 1;
+    fx.keys[0][1] = false;
+  }
+  CHECK(missed == 0);
+
+  // Y en reposo sigue sin tocar el bus
+  for (int t = 0; t < 200; t++)
+  {
+    b.update();
+    sim::advanceMs(1);
+  }
+  fx.bus = 0;
+  for (int t = 0; t < 100; t++)
+  {
+    b.update();
+    sim::advanceMs(1);
+  }
+  CHECK(fx.bus <= 1);
+
+  printf("%-8s int=1 grupos 1/20 ms en la misma fila: ok\n", chipName(chip));
+}
+
+int main()
+{
+  const SimChip chips[] = {SIM_MCP23017, SIM_MCP23S17, SIM_PCF8574};
+  for (SimChip c : chips)
+  {
+    run(c, false, 0);
+    run(c, true, 0);
+    run(c, false, 120);
+    runPrioRow(c);
+    runGroups(c);
+  }
+  printf("expander_sim: OK\n");
+  return 0;
+}
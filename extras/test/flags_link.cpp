@@ -0,0 +1,12 @@
+// Sketch mínimo para check_flags.sh: se enlaza contra la librería compilada
+// con los flags por defecto. Con los mismos flags tiene que enlazar; con otros
+// (-DJWMB_ENABLE_REPEAT=0) el link tiene que fallar (ver JWMB_FLAGS_NS).
+
+#include "JWMatrixButtons.h"
+
+int main()
+{
+  JWMatrixButtons b;
+  b.update();
+  return b.isDown(0) ? 1 : 0;
+}
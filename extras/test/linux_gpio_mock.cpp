@@ -0,0 +1,247 @@
+// Prueba de host de JWMatrixLinuxGpio sin hardware: se interponen ioctl(),
+// epoll_wait() y read() para simular un /dev/gpiochip con una matriz de teclas.
+//
+// - ioctl(): GET_LINE crea las líneas (un pipe por request, así epoll funciona
+//   sobre un fd real), SET_VALUES guarda el nivel de las filas y GET_VALUES
+//   calcula las columnas a partir de las teclas presionadas y del bias pedido.
+// - epoll_wait()/read(): pasan a libc (RTLD_NEXT) y cuentan las llamadas.
+//
+// Compilar/ejecutar: make linux (en extras/test)
+
+#include "JWMatrixButtons.h"
+#include "JWMatrixLinuxGpio.h"
+
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <linux/gpio.h>
+
+#include <chrono>
+#include <thread>
+
+#define CHECK(c)                                                   \
+  do                                                               \
+  {                                                                \
+    if (!(c))                                                      \
+    {                                                              \
+      fprintf(stderr, "%s:%d: falla: %s\n", __FILE__, __LINE__, #c); \
+      exit(1);                                                     \
+    }                                                              \
+  } while (0)
+
+// =========================
+// Chip simulado
+// =========================
+struct FakeChip
+{
+  int rowFd = -1;
+  int colFd = -1;
+  int colW = -1;          // extremo de escritura: flancos simulados
+  uint64_t rowFlags = 0;
+  uint64_t colFlags = 0;
+  uint64_t rowBits = 0;   // nivel actual de cada fila
+  uint32_t nRows = 0;
+  bool keys[8][8] = {};   // [fila][col]
+  int nIoctl = 0;
+  int nEpollWait = 0;
+  int nRead = 0;
+};
+
+static FakeChip chip;
+
+static void resetChip()
+{
+  if (chip.colW >= 0)
+    close(chip.colW);
+  chip = FakeChip();
+}
+
+// Nivel de las columnas: la tecla conecta su fila con su columna; sin tecla (o
+// con la fila en reposo) manda el bias.
+static uint64_t colLevels()
+{
+  bool activeHigh = (chip.colFlags & GPIO_V2_LINE_FLAG_BIAS_PULL_DOWN) != 0;
+  uint64_t bits = activeHigh ? 0 : ~0ull;
+  for (uint32_t r = 0; r < chip.nRows; r++)
+  {
+    bool rowHigh = (chip.rowBits >> r) & 1;
+    if (rowHigh != activeHigh)
+      continue;
+    for (int c = 0; c < 8; c++)
+    {
+      if (!chip.keys[r][c])
+        continue;
+      if (activeHigh)
+        bits |= (1ull << c);
+      else
+        bits &= ~(1ull << c);
+    }
+  }
+  return bits;
+}
+
+static void pushEdge()
+{
+  gpio_v2_line_event e;
+  memset(&e, 0, sizeof(e));
+  CHECK(write(chip.colW, &e, sizeof(e)) == (ssize_t)sizeof(e));
+}
+
+extern "C" int ioctl(int fd, unsigned long req, ...)
+{
+  va_list ap;
+  va_start(ap, req);
+  void *arg = va_arg(ap, void *);
+  va_end(ap);
+  chip.nIoctl++;
+
+  if (req == GPIO_V2_GET_LINE_IOCTL)
+  {
+    gpio_v2_line_request *r = (gpio_v2_line_request *)arg;
+    int p[2];
+    if (pipe(p) != 0)
+      return -1;
+    r->fd = p[0];
+    if (r->config.flags & GPIO_V2_LINE_FLAG_OUTPUT)
+    {
+      close(p[1]);
+      chip.rowFd = p[0];
+      chip.rowFlags = r->config.flags;
+      chip.nRows = r->num_lines;
+      chip.rowBits = r->config.attrs[0].attr.values & r->config.attrs[0].mask;
+    }
+    else
+    {
+      chip.colFd = p[0];
+      chip.colW = p[1];
+      chip.colFlags = r->config.flags;
+    }
+    return 0;
+  }
+  if (req == GPIO_V2_LINE_SET_VALUES_IOCTL)
+  {
+    gpio_v2_line_values *v = (gpio_v2_line_values *)arg;
+    CHECK(fd == chip.rowFd);
+    chip.rowBits = (chip.rowBits & ~v->mask) | (v->bits & v->mask);
+    return 0;
+  }
+  if (req == GPIO_V2_LINE_GET_VALUES_IOCTL)
+  {
+    gpio_v2_line_values *v = (gpio_v2_line_values *)arg;
+    CHECK(fd == chip.colFd);
+    v->bits = colLevels() & v->mask;
+    return 0;
+  }
+  return -1;
+}
+
+extern "C" int epoll_wait(int epfd, struct epoll_event *ev, int max, int timeout)
+{
+  typedef int (*Fn)(int, struct epoll_event *, int, int);
+  static Fn real = (Fn)dlsym(RTLD_NEXT, "epoll_wait");
+  chip.nEpollWait++;
+  return real(epfd, ev, max, timeout);
+}
+
+extern "C" ssize_t read(int fd, void *buf, size_t n)
+{
+  typedef ssize_t (*Fn)(int, void *, size_t);
+  static Fn real = (Fn)dlsym(RTLD_NEXT, "read");
+  chip.nRead++;
+  return real(fd, buf, n);
+}
+
+// =========================
+// Pruebas
+// =========================
+static const uint8_t ROWS[] = {5, 6};
+static const uint8_t COLS[] = {10, 11, 12};
+static const JWMatrixButtons::BtnMapItem MAP[] = {{0, 0, 0}, {1, 1, 2}};
+
+static void runMatrix(bool rowActiveHigh)
+{
+  resetChip();
+  FILE *f = fopen("/tmp/jwmb_fakechip", "w");
+  CHECK(f);
+  fclose(f);
+
+  JWMatrixLinuxGpio gpio("/tmp/jwmb_fakechip", rowActiveHigh);
+  JWMatrixButtons b;
+  b.setBackend(&gpio);
+  // invertLogic coherente con el nivel de fila (ver JWMatrixLinuxGpio.h)
+  CHECK(b.begin(ROWS, 2, COLS, 3, MAP, 2, 2, !rowActiveHigh, 20));
+
+  // Bias según el nivel de fila; filas en reposo al arrancar
+  if (rowActiveHigh)
+  {
+    CHECK(chip.colFlags & GPIO_V2_LINE_FLAG_BIAS_PULL_DOWN);
+    CHECK(!(chip.colFlags & GPIO_V2_LINE_FLAG_BIAS_PULL_UP));
+    CHECK(chip.rowBits == 0);
+  }
+  else
+  {
+    CHECK(chip.colFlags & GPIO_V2_LINE_FLAG_BIAS_PULL_UP);
+    CHECK(!(chip.colFlags & GPIO_V2_LINE_FLAG_BIAS_PULL_DOWN));
+    CHECK(chip.rowBits == 3);
+  }
+  CHECK(chip.colFlags & GPIO_V2_LINE_FLAG_EDGE_RISING);
+  CHECK(chip.colFlags & GPIO_V2_LINE_FLAG_EDGE_FALLING);
+
+  // Sin teclas: nada presionado
+  chip.nIoctl = 0;
+  b.update();
+  int perUpdate = chip.nIoctl;
+  CHECK(!b.isDown(0) && !b.isDown(1));
+
+  // Reposo: waitForActivity() bloquea en epoll hasta el timeout
+  chip.nEpollWait = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  CHECK(!b.waitForActivity(50));
+  CHECK(std::chrono::steady_clock::now() - t0 >= std::chrono::milliseconds(45));
+  CHECK(chip.nEpollWait >= 1);
+
+  // Un flanco en las columnas despierta la espera
+  std::thread th([] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    chip.keys[1][2] = true;
+    pushEdge();
+  });
+  CHECK(b.waitForActivity(1000));
+  th.join();
+
+  // Los flancos pendientes se vacían con read() no bloqueante
+  CHECK(chip.nRead >= 1);
+
+  for (int i = 0; i < 10; i++)
+  {
+    b.update();
+    usleep(5000);
+  }
+  CHECK(b.isDown(1) && b.pressed(1));
+  CHECK(!b.isDown(0));
+  // Con una tecla presionada no se duerme
+  CHECK(b.waitForActivity(1000));
+
+  chip.keys[1][2] = false;
+  for (int i = 0; i < 10; i++)
+  {
+    b.update();
+    usleep(5000);
+  }
+  CHECK(!b.isDown(1) && b.released(1));
+
+  printf("rowActiveHigh=%d: ok (%d ioctls por update)\n", rowActiveHigh ? 1 : 0, perUpdate);
+}
+
+int main()
+{
+  runMatrix(true);
+  runMatrix(false);
+  printf("linux_gpio_mock: OK\n");
+  return 0;
+}
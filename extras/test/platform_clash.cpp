@@ -0,0 +1,23 @@
+// Chequeo de compilación (host): la librería no define millis()/micros()/
+// delay()/delayMicroseconds() globales, así que convive con librerías que
+// declaran las suyas con otra firma (ej. wiringPi). Lo compila check_flags.sh.
+
+unsigned int millis(void);
+unsigned int micros(void);
+void delay(unsigned int howLong);
+void delayMicroseconds(unsigned int howLong);
+
+#include "JWMatrixButtons.h"
+#include "JWMatrixLinuxGpio.h"
+
+unsigned int millis(void)
+{
+  return 0;
+}
+
+int main()
+{
+  JWMatrixButtons btn;
+  (void)btn;
+  return (int)millis();
+}
@@ -0,0 +1,148 @@
+// Teclas prioritarias con Arduino simulado: cambio de mapa con la tecla
+// sostenida (ni RELEASE falso al conmutar ni RELEASE perdido al soltar), por
+// update() y por updatePriority(), y re-habilitar una tecla ya suelta.
+//
+// Compilar/ejecutar: make priority (en extras/test)
+
+#include "JWMatrixButtons.h"
+#include "sim_arduino.h"
+
+static const uint8_t ROWS[] = {20, 21};
+static const uint8_t COLS[] = {30, 31};
+static const uint8_t STOP = 0;
+
+// Mapa A: STOP en (0,0). Mapa B: la misma posición es una tecla normal.
+static const JWMatrixButtons::BtnMapItem MAP_A[] = {
+    {STOP, 0, 0}, {1, 0, 1}, {2, 1, 0}};
+static const JWMatrixButtons::BtnMapItem MAP_B[] = {
+    {3, 0, 0}, {1, 0, 1}, {2, 1, 0}};
+
+static bool keys[2][2];
+
+// Columna en HIGH si alguna fila activa (HIGH) tiene su tecla presionada
+static int readPin(uint8_t pin)
+{
+  for (int c = 0; c < 2; c++)
+  {
+    if (pin != COLS[c])
+      continue;
+    for (int r = 0; r < 2; r++)
+    {
+      if (sim::level[ROWS[r]] && keys[r][c])
+        return HIGH;
+    }
+    return LOW;
+  }
+  return -1;
+}
+
+static int nPress = 0;
+static int nRelease = 0;
+
+static void onPrio(uint8_t id, JWMatrixButtons::EvType type, void *ctx)
+{
+  (void)ctx;
+  CHECK(id == STOP);
+  if (type == JWMatrixButtons::EV_PRESS)
+    nPress++;
+  else if (type == JWMatrixButtons::EV_RELEASE)
+    nRelease++;
+}
+
+// usePrio: además de update() cada 5 ms, updatePriority() cada 1 ms (como el
+// task de ESP32)
+static void stepMs(JWMatrixButtons &b, int ms, bool usePrio)
+{
+  for (int i = 0; i < ms; i++)
+  {
+    if (i % 5 == 0)
+      b.update();
+    else if (usePrio)
+      b.updatePriority();
+    sim::advanceMs(1);
+  }
+}
+
+static void mapSwapWhileHeld(bool usePrio)
+{
+  sim::reset();
+  sim::readHook = readPin;
+  keys[0][0] = false;
+  nPress = 0;
+  nRelease = 0;
+
+  JWMatrixButtons b;
+  CHECK(b.begin(ROWS, 2, COLS, 2, MAP_A, 3, 4, false, 20));
+  CHECK(b.setLayerMap(0, MAP_A, 3));
+  CHECK(b.setLayerMap(1, MAP_B, 3));
+  CHECK(b.setPriorityKey(STOP, true));
+  b.setPriorityCallback(onPrio);
+  stepMs(b, 50, usePrio);
+
+  keys[0][0] = true;
+  stepMs(b, 100, usePrio);
+  CHECK(nPress == 1 && nRelease == 0);
+  CHECK(b.isDown(STOP));
+
+  // Conmutar a un mapa donde (0,0) no es prioritaria: STOP sigue sostenida
+  CHECK(b.setLayer(1));
+  stepMs(b, 200, usePrio);
+  CHECK(nRelease == 0);
+  CHECK(b.isDown(STOP) && !b.isDown(3));
+
+  // Al soltarla llega el RELEASE (una sola vez)
+  keys[0][0] = false;
+  stepMs(b, 100, usePrio);
+  CHECK(nPress == 1 && nRelease == 1);
+  CHECK(!b.isDown(STOP));
+
+  // Ya suelta, la posición es la tecla 3 del mapa B (sin callback)
+  keys[0][0] = true;
+  stepMs(b, 100, usePrio);
+  CHECK(b.isDown(3) && !b.isDown(STOP));
+  CHECK(nPress == 1);
+  keys[0][0] = false;
+  stepMs(b, 100, usePrio);
+}
+
+static void reEnable()
+{
+  sim::reset();
+  sim::readHook = readPin;
+  keys[0][0] = false;
+  nPress = 0;
+  nRelease = 0;
+
+  JWMatrixButtons b;
+  CHECK(b.begin(ROWS, 2, COLS, 2, MAP_A, 3, 4, false, 20));
+  CHECK(b.setPriorityKey(STOP, true));
+  b.setPriorityCallback(onPrio);
+  stepMs(b, 50, true);
+
+  // Deshabilitar con la tecla presionada, soltarla y volver a habilitar: no
+  // debe salir un RELEASE de una tecla que ya está suelta
+  keys[0][0] = true;
+  stepMs(b, 100, true);
+  CHECK(nPress == 1);
+  CHECK(b.setPriorityKey(STOP, false));
+  keys[0][0] = false;
+  stepMs(b, 100, true);
+  CHECK(b.setPriorityKey(STOP, true));
+  stepMs(b, 100, true);
+  CHECK(nPress == 1 && nRelease == 0);
+
+  keys[0][0] = true;
+  stepMs(b, 100, true);
+  keys[0][0] = false;
+  stepMs(b, 100, true);
+  CHECK(nPress == 2 && nRelease == 1);
+}
+
+int main()
+{
+  mapSwapWhileHeld(false);
+  mapSwapWhileHeld(true);
+  reEnable();
+  printf("priority_sim: OK\n");
+  return 0;
+}
@@ -0,0 +1,96 @@
+// applyRamp() con Arduino simulado: el mismo guion de teclas tiene que dar el
+// mismo valor final a cualquier ritmo de loop. update() corre cada 1 ms (como
+// el task de ESP32) y applyRamp() cada P ms.
+//
+// El guion incluye mantenidos que terminan y vuelven a empezar entre dos
+// llamadas a ritmos lentos, toques cortos y un press del otro botón con el
+// primero aún presionado. Los ritmos probados llegan hasta 150 ms: más lento
+// que eso, el guion mete dos presses del mismo botón entre dos llamadas (fuera
+// del contrato, ver applyRamp() en JWMatrixButtons.h).
+//
+// Compilar/ejecutar: make ramp (en extras/test)
+
+#include "JWMatrixButtons.h"
+#include "sim_arduino.h"
+
+static const uint8_t ROWS[] = {20};
+static const uint8_t COLS[] = {30, 31};
+static const uint8_t DEC = 0;
+static const uint8_t INC = 1;
+static const JWMatrixButtons::BtnMapItem MAP[] = {{DEC, 0, 0}, {INC, 0, 1}};
+
+static bool keys[2];
+
+static int readPin(uint8_t pin)
+{
+  for (int c = 0; c < 2; c++)
+  {
+    if (pin == COLS[c])
+      return (sim::level[ROWS[0]] && keys[c]) ? HIGH : LOW;
+  }
+  return -1;
+}
+
+struct Step
+{
+  uint32_t t;  // ms desde el inicio
+  uint8_t id;
+  bool down;
+};
+
+static const Step SCRIPT[] = {
+    {100, INC, true},   {3100, INC, false},  // mantenido largo
+    {3160, INC, true},  {5160, INC, false},  // re-press a 60 ms
+    {5200, INC, true},  {5280, INC, false},  // toque corto
+    {5330, INC, true},  {6330, INC, false},
+    {6700, DEC, true},  {8200, DEC, false},
+    {8240, DEC, true},  {8300, DEC, false},  // toque
+    {8340, DEC, true},  {9100, DEC, false},
+    {9500, INC, true},  {11000, DEC, true},  // DEC toma el eje con INC abajo
+    {11800, INC, false}, {12600, DEC, false},
+    {12650, INC, true}, {16650, INC, false},
+};
+static const uint32_t END_MS = 17500;
+
+static uint32_t run(uint32_t periodMs)
+{
+  sim::reset();
+  sim::readHook = readPin;
+  keys[0] = keys[1] = false;
+
+  JWMatrixButtons b;
+  CHECK(b.begin(ROWS, 1, COLS, 2, MAP, 2, 2, false, 20));
+
+  JWMatrixButtons::RampState st = {};
+  uint32_t v = 10000;
+  size_t next = 0;
+  for (uint32_t t = 0; t < END_MS; t++)
+  {
+    while (next < sizeof(SCRIPT) / sizeof(SCRIPT[0]) && SCRIPT[next].t == t)
+    {
+      keys[SCRIPT[next].id] = SCRIPT[next].down;
+      next++;
+    }
+    b.update();
+    if (t % periodMs == 0)
+      b.applyRamp(v, 0, 1000000, DEC, INC, st);
+    sim::advanceMs(1);
+  }
+  b.applyRamp(v, 0, 1000000, DEC, INC, st);
+  return v;
+}
+
+int main()
+{
+  static const uint32_t periods[] = {1, 10, 50, 150};
+  uint32_t ref = run(1);
+  for (uint32_t p : periods)
+  {
+    uint32_t v = run(p);
+    printf("ramp_sim: loop %3u ms -> %u\n", (unsigned)p, (unsigned)v);
+    CHECK(v == ref);
+  }
+  CHECK(ref != 10000);
+  printf("ramp_sim: OK\n");
+  return 0;
+}
@@ -0,0 +1,95 @@
+#include "sim_arduino.h"
+
+#include <string.h>
+
+namespace sim
+{
+uint64_t nowUs = 0;
+uint8_t level[64];
+uint8_t mode[64];
+int (*readHook)(uint8_t pin) = nullptr;
+void (*writeHook)(uint8_t pin, uint8_t v) = nullptr;
+void (*modeHook)(uint8_t pin, uint8_t m) = nullptr;
+
+void advanceMs(uint32_t ms)
+{
+  nowUs += (uint64_t)ms * 1000u;
+}
+
+void reset()
+{
+  nowUs = 0;
+  memset(level, 0, sizeof(level));
+  memset(mode, 0, sizeof(mode));
+  readHook = nullptr;
+  writeHook = nullptr;
+  modeHook = nullptr;
+}
+} // namespace sim
+
+uint32_t millis()
+{
+  return (uint32_t)(sim::nowUs / 1000u);
+}
+
+uint32_t micros()
+{
+  return (uint32_t)sim::nowUs;
+}
+
+void delay(uint32_t ms)
+{
+  sim::nowUs += (uint64_t)ms * 1000u;
+}
+
+void delayMicroseconds(uint32_t us)
+{
+  sim::nowUs += us;
+}
+
+void pinMode(uint8_t pin, uint8_t m)
+{
+  sim::mode[pin & 63] = m;
+  if (m == INPUT_PULLUP)
+    sim::level[pin & 63] = HIGH;
+  if (sim::modeHook)
+    sim::modeHook(pin, m);
+}
+
+void digitalWrite(uint8_t pin, uint8_t v)
+{
+  sim::level[pin & 63] = v;
+  if (sim::writeHook)
+    sim::writeHook(pin, v);
+}
+
+int digitalRead(uint8_t pin)
+{
+  if (sim::readHook)
+  {
+    int v = sim::readHook(pin);
+    if (v >= 0)
+      return v;
+  }
+  return sim::level[pin & 63];
+}
+
+void attachInterrupt(uint8_t irq, void (*fn)(), int m)
+{
+  (void)irq;
+  (void)fn;
+  (void)m;
+}
+
+void attachInterruptArg(uint8_t irq, void (*fn)(void *), void *arg, int m)
+{
+  (void)irq;
+  (void)fn;
+  (void)arg;
+  (void)m;
+}
+
+void detachInterrupt(uint8_t irq)
+{
+  (void)irq;
+}
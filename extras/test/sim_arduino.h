@@ -0,0 +1,32 @@
+#pragma once
+// Arduino simulado para las pruebas de host (extras/test): tiempo virtual y
+// niveles de pin. delay()/delayMicroseconds() avanzan el reloj sin dormir.
+#include <Arduino.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define CHECK(c)                                                     \
+  do                                                                 \
+  {                                                                  \
+    if (!(c))                                                        \
+    {                                                                \
+      fprintf(stderr, "%s:%d: falla: %s\n", __FILE__, __LINE__, #c); \
+      exit(1);                                                       \
+    }                                                                \
+  } while (0)
+
+namespace sim
+{
+extern uint64_t nowUs;      // reloj virtual
+extern uint8_t level[64];   // último digitalWrite() por pin
+extern uint8_t mode[64];    // último pinMode() por pin
+
+// Ganchos opcionales de cada prueba
+extern int (*readHook)(uint8_t pin);               // -1 = usar level[]
+extern void (*writeHook)(uint8_t pin, uint8_t v);
+extern void (*modeHook)(uint8_t pin, uint8_t m);
+
+void advanceMs(uint32_t ms);
+void reset();
+} // namespace sim
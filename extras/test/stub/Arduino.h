@@ -0,0 +1,51 @@
+#pragma once
+// Stub mínimo de Arduino para compilar/simular la librería en host (extras/test).
+// Solo declaraciones: cada programa de prueba define las funciones que usa.
+#include <stdint.h>
+#include <stddef.h>
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define CHANGE 3
+#ifndef ARDUINO
+#define ARDUINO 10819
+#endif
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+void attachInterrupt(uint8_t irq, void (*fn)(), int mode);
+void attachInterruptArg(uint8_t irq, void (*fn)(void *), void *arg, int mode);
+void detachInterrupt(uint8_t irq);
+
+#define digitalPinToInterrupt(p) (p)
+#define ARDUINO_ISR_ATTR
+
+// Con -DJWMB_TEST_PORT_READ: registros de entrada por puerto (8 pines por
+// puerto), para probar la lectura por puerto de JWMatrixTopology.
+#if defined(JWMB_TEST_PORT_READ)
+extern volatile uint8_t g_portIn[8];
+#define digitalPinToPort(p) ((p) / 8)
+#define digitalPinToBitMask(p) (1u << ((p) % 8))
+#define portInputRegister(port) (&g_portIn[port])
+#endif
+
+// Con -DJWMB_TEST_PORT_PTR: el puerto es un puntero a struct, como en
+// STM32duino (portInputRegister(P) = &(P->IDR)). Solo para compilar.
+#if defined(JWMB_TEST_PORT_PTR)
+struct JwmbTestGpio
+{
+  volatile uint32_t IDR;
+};
+extern JwmbTestGpio g_gpio[8];
+#define digitalPinToPort(p) (&g_gpio[(p) / 8])
+#define digitalPinToBitMask(p) (1u << ((p) % 8))
+#define portInputRegister(P) (&((P)->IDR))
+#endif
@@ -0,0 +1,28 @@
+#pragma once
+// Stub de SPI (SPIClass): lo implementa el expansor simulado de extras/test
+#include <stdint.h>
+
+#define MSBFIRST 1
+#define SPI_MODE0 0
+
+class SPISettings
+{
+public:
+  SPISettings(uint32_t clock, uint8_t bitOrder, uint8_t dataMode)
+  {
+    (void)clock;
+    (void)bitOrder;
+    (void)dataMode;
+  }
+};
+
+class SPIClass
+{
+public:
+  void begin();
+  void beginTransaction(SPISettings settings);
+  uint8_t transfer(uint8_t v);
+  void endTransaction();
+};
+
+extern SPIClass SPI;
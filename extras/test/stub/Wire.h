@@ -0,0 +1,18 @@
+#pragma once
+// Stub de Wire (TwoWire): lo implementa el expansor simulado de extras/test
+#include <stdint.h>
+#include <stddef.h>
+
+class TwoWire
+{
+public:
+  void begin();
+  void beginTransmission(uint8_t addr);
+  size_t write(uint8_t v);
+  uint8_t endTransmission(bool stop = true);
+  uint8_t requestFrom(uint8_t addr, uint8_t n);
+  int available();
+  int read();
+};
+
+extern TwoWire Wire;
@@ -0,0 +1,12 @@
+#pragma once
+// Stub de FreeRTOS (solo para compilar con -DARDUINO_ARCH_ESP32 en host)
+#include <stdint.h>
+typedef void *SemaphoreHandle_t;
+typedef void *TaskHandle_t;
+typedef uint32_t StackType_t;
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+typedef uint32_t TickType_t;
+#define portMAX_DELAY 0xffffffffu
+#define pdPASS 1
+#define pdMS_TO_TICKS(x) (x)
@@ -0,0 +1,108 @@
+// Traza de eventos de 60 s (simulados) con teclas al azar: press/release,
+// repeats (incluido el id 31, el bit alto de las máscaras de 32 bits) y
+// applyAxis(). Se compara un hash de la traza con el de referencia, generado
+// antes de separar el estado por botón en máscaras + bloque de tiempos: un
+// refactor del núcleo no debe cambiar ni un evento.
+//
+// Uso: make trace (en extras/test). "trace_sim -v" imprime la traza completa.
+
+#include "JWMatrixButtons.h"
+#include "sim_arduino.h"
+
+#include <string.h>
+
+// FNV-1a de 64 bits de la traza de referencia
+static const uint64_t TRACE_GOLDEN = 0x3d710b9f3ba94d03ull;
+
+static const uint8_t ROWS[] = {20, 21};
+static const uint8_t COLS[] = {30, 31, 32};
+static const JWMatrixButtons::BtnMapItem MAP[] = {
+    {0, 0, 0}, {1, 0, 1}, {2, 1, 0}, {3, 1, 1}, {31, 1, 2}};
+
+static bool keys[2][3];
+
+// Columna en HIGH si alguna fila activa (HIGH) tiene su tecla presionada
+static int readPin(uint8_t pin)
+{
+  for (int c = 0; c < 3; c++)
+  {
+    if (pin != COLS[c])
+      continue;
+    for (int r = 0; r < 2; r++)
+    {
+      if (sim::level[ROWS[r]] && keys[r][c])
+        return HIGH;
+    }
+    return LOW;
+  }
+  return -1;
+}
+
+static uint64_t hash = 0xcbf29ce484222325ull;
+static bool verbose = false;
+
+static void emit(const char *line)
+{
+  if (verbose)
+    fputs(line, stdout);
+  for (const char *p = line; *p; p++)
+  {
+    hash ^= (uint8_t)*p;
+    hash *= 0x100000001b3ull;
+  }
+}
+
+int main(int argc, char **argv)
+{
+  verbose = (argc > 1 && strcmp(argv[1], "-v") == 0);
+  sim::reset();
+  sim::readHook = readPin;
+
+  JWMatrixButtons b;
+  CHECK(b.begin(ROWS, 2, COLS, 3, MAP, 5, 32, false, 20));
+  b.setRepeatEnabled(0, true);
+  b.setRepeatEnabled(3, true);
+  b.setRepeatEnabled(31, true);
+  b.setRepeatInitialDelay(200);
+
+  char line[96];
+  uint32_t seed = 1;
+  uint32_t v = 0;
+  uint32_t nEvents = 0;
+  for (int t = 0; t < 60000; t++)
+  {
+    if (t % 37 == 0)
+    {
+      seed = seed * 1103515245u + 12345u;
+      int r = (seed >> 16) % 2;
+      int c = (seed >> 20) % 3;
+      if ((seed >> 8) % 3 == 0)
+        keys[r][c] = !keys[r][c];
+    }
+
+    b.update();
+    for (uint8_t i = 0; i < b.eventCount(); i++)
+    {
+      JWMatrixButtons::BtnEvent e;
+      b.getEvent(i, e);
+      snprintf(line, sizeof(line), "%d %u %d %d %u\n", t, e.id, (int)e.type, e.mult,
+               (unsigned)e.held_ms);
+      emit(line);
+      nEvents++;
+    }
+    if (t % 13 == 0)
+    {
+      b.applyAxis(v, 0, 99999, 0, 3);
+      snprintf(line, sizeof(line), "v %u %d\n", (unsigned)v, b.isDown(31) ? 1 : 0);
+      emit(line);
+    }
+    sim::advanceMs(3);
+  }
+
+  printf("trace_sim: %u eventos, hash %016llx\n", (unsigned)nEvents,
+         (unsigned long long)hash);
+  CHECK(nEvents > 1000);
+  CHECK(hash == TRACE_GOLDEN);
+  printf("trace_sim: OK\n");
+  return 0;
+}
@@ -0,0 +1,67 @@
+#include "JWMatrixBackend.h"
+
+const uint8_t JWMatrixBackend::INDEX[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+
+#if defined(ARDUINO)
+
+JWMatrixGpioBackend::JWMatrixGpioBackend()
+    : _rowPins(nullptr), _colPins(nullptr), _nRows(0), _nCols(0), _active(ROW_NONE)
+{
+}
+
+bool JWMatrixGpioBackend::begin(const uint8_t *rowPins, uint8_t nRows,
+                                const uint8_t *colPins, uint8_t nCols)
+{
+  _rowPins = rowPins;
+  _colPins = colPins;
+  _nRows = nRows;
+  _nCols = nCols;
+  _active = ROW_NONE;
+
+  for (uint8_t r = 0; r < _nRows; r++)
+  {
+    pinMode(_rowPins[r], OUTPUT);
+    digitalWrite(_rowPins[r], LOW);
+  }
+  for (uint8_t c = 0; c < _nCols; c++)
+  {
+    pinMode(_colPins[c], INPUT);
+  }
+  return true;
+}
+
+void JWMatrixGpioBackend::selectRow(uint8_t row)
+{
+  // Solo tocar los pines que cambian: 1 write al activar, 1 al soltar
+  if (row == _active)
+    return;
+
+  if (_active == ROW_ALL || row == ROW_ALL)
+  {
+    for (uint8_t r = 0; r < _nRows; r++)
+      digitalWrite(_rowPins[r], (row == ROW_ALL || r == row) ? HIGH : LOW);
+  }
+  else
+  {
+    if (_active < _nRows)
+      digitalWrite(_rowPins[_active], LOW);
+    if (row < _nRows)
+      digitalWrite(_rowPins[row], HIGH);
+  }
+  _active = row;
+}
+
+uint8_t JWMatrixGpioBackend::readCols(uint8_t colMask)
+{
+  uint8_t bits = 0;
+  while (colMask)
+  {
+    uint8_t c = (uint8_t)__builtin_ctz(colMask);
+    colMask &= (uint8_t)(colMask - 1);
+    if (digitalRead(_colPins[c]) == HIGH)
+      bits |= (uint8_t)(1u << c);
+  }
+  return bits;
+}
+
+#endif
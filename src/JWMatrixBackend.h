@@ -0,0 +1,97 @@
+#pragma once
+#include "JWMatrixPlatform.h"
+
+// =========================
+// Backend de escaneo
+// =========================
+// Es lo que está debajo de scanRaw(): activar filas y leer columnas. El resto
+// (plan de escaneo, debounce, eventos, repeats, latches, applyAxis) es igual
+// para todos los backends.
+//
+// - En Arduino, JWMatrixButtons usa por defecto JWMatrixGpioBackend
+//   (pinMode/digitalWrite/digitalRead).
+// - Otro backend se instala con setBackend() antes de begin().
+class JWMatrixBackend
+{
+public:
+  static const uint8_t ROW_NONE = 0xFF; // ninguna fila activa (reposo)
+  static const uint8_t ROW_ALL = 0xFE;  // todas activas (detección de actividad)
+
+  // Topología propia (teclas directas, charlieplex): el backend define sus
+  // filas/columnas virtuales y los delays de escaneo que necesita. Se usa con
+  // JWMatrixButtons::begin(map, ...), que le pasa INDEX (0..7) como pines.
+  struct Topology
+  {
+    uint8_t nRows;
+    uint8_t nCols;
+    uint16_t settleUs;
+    uint16_t betweenRowsUs;
+  };
+  static const uint8_t INDEX[8];
+
+  virtual ~JWMatrixBackend() {}
+
+  // Filas como salida en reposo, columnas como entrada
+  virtual bool begin(const uint8_t *rowPins, uint8_t nRows,
+                     const uint8_t *colPins, uint8_t nCols) = 0;
+
+  // Activa solo la fila row (las demás en reposo), o ROW_NONE / ROW_ALL
+  virtual void selectRow(uint8_t row) = 0;
+
+  // Nivel de las columnas pedidas: bit c = columna c en HIGH. La lógica
+  // invertida la aplica JWMatrixButtons.
+  virtual uint8_t readCols(uint8_t colMask) = 0;
+
+  // ¿Pudo haber actividad desde el último escaneo? (ej. línea INT de un
+  // expansor). Si devuelve false y no hay teclas activas, update() se salta
+  // el escaneo.
+  virtual bool activityPending()
+  {
+    return true;
+  }
+
+  // Bloquea hasta un flanco en cualquier columna o timeout (se llama con
+  // ROW_ALL activo). Devuelve true si hubo flanco o si el backend no sabe
+  // esperar (entonces el llamador simplemente sigue escaneando).
+  virtual bool waitColEdge(uint32_t timeoutMs)
+  {
+    (void)timeoutMs;
+    return true;
+  }
+
+  // JWMatrixButtons avisa su settle (begin() y setScanDelays()): el delay entre
+  // selectRow(fila) y readCols(). Sirve a backends que difieren la escritura de
+  // la fila (ej. expansores) para saber si ese delay debe caer tras escribirla.
+  virtual void setSettleUs(uint16_t settleUs)
+  {
+    (void)settleUs;
+  }
+
+  // false = matriz clásica: filas/columnas las da begin()
+  virtual bool topology(Topology &out) const
+  {
+    (void)out;
+    return false;
+  }
+};
+
+#if defined(ARDUINO)
+// Backend por defecto en Arduino: un GPIO por fila/columna
+class JWMatrixGpioBackend : public JWMatrixBackend
+{
+public:
+  JWMatrixGpioBackend();
+
+  bool begin(const uint8_t *rowPins, uint8_t nRows,
+             const uint8_t *colPins, uint8_t nCols) override;
+  void selectRow(uint8_t row) override;
+  uint8_t readCols(uint8_t colMask) override;
+
+private:
+  const uint8_t *_rowPins;
+  const uint8_t *_colPins;
+  uint8_t _nRows;
+  uint8_t _nCols;
+  uint8_t _active; // fila activa (o ROW_NONE / ROW_ALL)
+};
+#endif
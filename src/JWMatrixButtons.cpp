@@ -1,21 +1,55 @@
 #include "JWMatrixButtons.h"
 
+using namespace jwmb; // millis()/micros()/delay*() fuera de Arduino
+
 JWMatrixButtons::JWMatrixButtons()
-    : _rowPins(nullptr), _colPins(nullptr), _nRows(0), _nCols(0),
+    :
+#if defined(ARDUINO)
+      _backend(&_gpio),
+#else
+      _backend(nullptr),
+#endif
+      _rowPins(nullptr), _colPins(nullptr), _nRows(0), _nCols(0),
       _map(nullptr), _mapLen(0), _btnCount(0),
+      _planActive(0), _layer(0),
       _invert(false), _debounceMs(35),
-      _settleUs(120), _betweenRowsUs(40),
+      _settleUs(120), _betweenRowsUs(40)
+#if JWMB_ENABLE_REPEAT
+      ,
       _repeatInitialDelay(350),
       _thr1(12), _thr2(30), _thr3(70),
       _s1(1), _s2(10), _s3(100), _s4(1000),
-      _d1(110), _d2(95), _d3(80), _d4(65),
+      _d1(110), _d2(95), _d3(80), _d4(65)
+#endif
+#if JWMB_ENABLE_EVENT_LOG
+      ,
       _evN(0)
+#endif
 {
-#if defined(ARDUINO_ARCH_ESP32)
+#if JWMB_ENABLE_DIAGNOSTICS
+  _stuckMs = 30000;
+  _unsettledMs = 500;
+#endif
+#if JWMB_ENABLE_PRIORITY
+  _prioCb = nullptr;
+  _prioCtx = nullptr;
+  _prioLatMaxUs = 0;
+#endif
+#if JWMB_HAS_RTOS
   _mtx = nullptr;
   _taskRun = false;
   _taskHandle = nullptr;
   _taskPeriod = 5;
+#endif
+  // Después de _mtx: los setters toman el lock
+#if JWMB_ENABLE_AXIS
+  // ~ misma sensación que el perfil de repeat por defecto
+  setRampProfile(350, 9, 1700, 100, 3500, 1000, 7000, 10000);
+#endif
+#if JWMB_ENABLE_ENCODER
+  _encN = 0;
+  _encPolled = 0;
+  setEncoderProfile(10, 25, 50, 1, 10, 100, 1000);
 #endif
   resetStates();
 }
@@ -29,7 +63,7 @@ bool JWMatrixButtons::begin(const uint8_t *rowPins, uint8_t nRows,
 {
   stopTask();
 
-#if defined(ARDUINO_ARCH_ESP32)
+#if JWMB_HAS_RTOS
   if (!_mtx)
   {
     _mtx = xSemaphoreCreateMutex();
@@ -44,6 +78,9 @@ bool JWMatrixButtons::begin(const uint8_t *rowPins, uint8_t nRows,
     return false;
   if (mapLen == 0 || mapLen > buttonCount)
     return false;
+  if (!_backend || !_backend->begin(rowPins, nRows, colPins, nCols))
+    return false;
+  _backend->setSettleUs(_settleUs);
 
   _rowPins = rowPins;
   _colPins = colPins;
@@ -55,37 +92,678 @@ bool JWMatrixButtons::begin(const uint8_t *rowPins, uint8_t nRows,
   _invert = invertLogic;
   _debounceMs = debounceMs;
 
+  for (uint8_t l = 0; l < MAX_LAYERS; l++)
+  {
+    _layerMap[l] = nullptr;
+    _layerLen[l] = 0;
+  }
+  _layerMap[0] = map;
+  _layerLen[0] = mapLen;
+  _layer = 0;
+  _planActive = 0;
+
+  lock();
+  resetStates();
+  compileMap_(_plan[0], map, mapLen); // después del reset: usa la config por id
+#if JWMB_ENABLE_EVENT_LOG
+  _evN = 0;
+#endif
+  unlock();
+  return true;
+}
+
+bool JWMatrixButtons::begin(const BtnMapItem *map, uint8_t mapLen,
+                            uint8_t buttonCount,
+                            bool invertLogic,
+                            uint32_t debounceMs)
+{
+  JWMatrixBackend::Topology t;
+  if (!_backend || !_backend->topology(t))
+    return false;
+  if (!begin(JWMatrixBackend::INDEX, t.nRows, JWMatrixBackend::INDEX, t.nCols,
+             map, mapLen, buttonCount, invertLogic, debounceMs))
+    return false;
+  setScanDelays(t.settleUs, t.betweenRowsUs);
+  return true;
+}
+
+void JWMatrixButtons::setBackend(JWMatrixBackend *backend)
+{
+  stopTask();
+  lock();
+  _backend = backend;
+  _rowPins = nullptr; // obliga a begin() con el backend nuevo
+  _colPins = nullptr;
+  unlock();
+}
+
+// =========================
+// Mapas / capas en caliente
+// =========================
+
+bool JWMatrixButtons::setMap(const BtnMapItem *map, uint8_t mapLen)
+{
+  if (!map || !_rowPins)
+    return false;
+  if (mapLen == 0 || mapLen > _btnCount)
+    return false;
+
+  // Compilar en el buffer inactivo (sin lock: update() solo lee el activo)
+  uint8_t next = (uint8_t)(_planActive ^ 1);
+  compileMap_(_plan[next], map, mapLen);
+
+  // Conmutar entre frames
+  lock();
+  _planActive = next;
+  _map = map;
+  _mapLen = mapLen;
+  unlock();
+  return true;
+}
+
+bool JWMatrixButtons::setLayerMap(uint8_t layer, const BtnMapItem *map, uint8_t mapLen)
+{
+  if (layer >= MAX_LAYERS || !map)
+    return false;
+  if (mapLen == 0 || mapLen > _btnCount)
+    return false;
+
+  _layerMap[layer] = map;
+  _layerLen[layer] = mapLen;
+
+  if (layer == _layer)
+    return setMap(map, mapLen);
+  return true;
+}
+
+bool JWMatrixButtons::setLayer(uint8_t layer)
+{
+  if (layer >= MAX_LAYERS || !_layerMap[layer])
+    return false;
+  if (!setMap(_layerMap[layer], _layerLen[layer]))
+    return false;
+  _layer = layer;
+  return true;
+}
+
+uint8_t JWMatrixButtons::layer() const
+{
+  return _layer;
+}
+
+void JWMatrixButtons::compileMap_(ScanPlan &dst, const BtnMapItem *map, uint8_t mapLen) const
+{
+  for (uint8_t r = 0; r < MAX_ROWS; r++)
+  {
+    dst.colMask[r] = 0;
+#if JWMB_ENABLE_PRIORITY
+    dst.prioMask[r] = 0;
+#endif
+#if JWMB_ENABLE_SCAN_GROUPS
+    for (uint8_t g = 0; g < MAX_SCAN_GROUPS; g++)
+      dst.grpMask[g][r] = 0;
+#endif
+    for (uint8_t c = 0; c < MAX_COLS; c++)
+      dst.id[r][c] = NO_ID;
+  }
+#if JWMB_ENABLE_SCAN_GROUPS
+  dst.grpUsed = 0x01; // el grupo 0 también escanea posiciones huérfanas
+#endif
+
+  // Validación una sola vez: entradas fuera de rango se descartan aquí y el
+  // escaneo ya no las vuelve a revisar
+
+  for (uint8_t i = 0; i < mapLen; i++)
+  {
+    const BtnMapItem &m = map[i];
+    if (m.id >= _btnCount)
+      continue;
+    if (m.row >= _nRows || m.col >= _nCols)
+      continue;
+
+    dst.id[m.row][m.col] = m.id;
+    dst.colMask[m.row] |= (uint8_t)(1u << m.col);
+#if JWMB_ENABLE_PRIORITY
+    if (_prioIds & (1ul << m.id))
+      dst.prioMask[m.row] |= (uint8_t)(1u << m.col);
+#endif
+#if JWMB_ENABLE_SCAN_GROUPS
+    uint8_t g = (_keyGroup[m.id] != GROUP_OF_ROW) ? _keyGroup[m.id] : _rowGroup[m.row];
+    dst.grpMask[g][m.row] |= (uint8_t)(1u << m.col);
+    dst.grpUsed |= (uint8_t)(1u << g);
+#endif
+  }
+}
+
+#if JWMB_ENABLE_SCAN_GROUPS
+// =========================
+// Grupos de escaneo
+// =========================
+
+bool JWMatrixButtons::setScanGroup(uint8_t group, uint16_t periodMs, uint32_t debounceMs)
+{
+  if (group >= MAX_SCAN_GROUPS)
+    return false;
+  lock();
+  ScanGroup &sg = _grp[group];
+  sg.periodMs = periodMs;
+  sg.debounceMs = debounceMs;
+  sg.next = millis();
+  if (group == 0)
+    _debounceMs = debounceMs;
+  unlock();
+  return true;
+}
+
+bool JWMatrixButtons::setRowGroup(uint8_t row, uint8_t group)
+{
+  if (row >= _nRows || group >= MAX_SCAN_GROUPS || !_map)
+    return false;
+  _rowGroup[row] = group;
+
+  // Recompilar el plan (grpMask) y conmutarlo entre frames
+  return setMap(_map, _mapLen);
+}
+
+bool JWMatrixButtons::setKeyGroup(uint8_t id, uint8_t group)
+{
+  if (id >= _btnCount || !_map)
+    return false;
+  if (group >= MAX_SCAN_GROUPS && group != GROUP_OF_ROW)
+    return false;
+  _keyGroup[id] = group;
+  return setMap(_map, _mapLen);
+}
+
+uint8_t JWMatrixButtons::dueGroups_(uint32_t now)
+{
+  // Scheduler: un solo reloj para todos los grupos. Un grupo atrasado (loop
+  // lento) se escanea una vez y se re-agenda desde ahora, sin acumular.
+  uint8_t due = 0;
+  uint8_t used = _plan[_planActive].grpUsed;
+  while (used)
+  {
+    uint8_t g = (uint8_t)__builtin_ctz(used);
+    used &= (uint8_t)(used - 1);
+    ScanGroup &sg = _grp[g];
+    if (sg.periodMs)
+    {
+      if ((int32_t)(now - sg.next) < 0)
+        continue;
+      sg.next += sg.periodMs;
+      if ((int32_t)(now - sg.next) >= 0)
+        sg.next = now + sg.periodMs;
+    }
+    due |= (uint8_t)(1u << g);
+  }
+  return due;
+}
+
+uint8_t JWMatrixButtons::groupCols_(uint8_t g, uint8_t r) const
+{
+  const ScanPlan &plan = _plan[_planActive];
+  uint8_t cols = plan.grpMask[g][r];
+  // Sostenidas que el mapa actual ya no usa: viajan con el grupo 0
+  if (g == 0)
+    cols |= (uint8_t)(_heldMask[r] & ~plan.colMask[r]);
+  return cols;
+}
+
+uint16_t JWMatrixButtons::schedTickMs_() const
+{
+  uint16_t tick = 5;
+#if JWMB_HAS_RTOS
+  tick = _taskPeriod;
+#endif
+  uint8_t used = _plan[_planActive].grpUsed;
+  for (uint8_t g = 0; g < MAX_SCAN_GROUPS; g++)
+  {
+    uint16_t p = _grp[g].periodMs;
+    if ((used & (1u << g)) && p && p < tick)
+      tick = p;
+  }
+  return tick;
+}
+#endif
+
+#if JWMB_ENABLE_PRIORITY
+// =========================
+// Teclas prioritarias
+// =========================
+
+bool JWMatrixButtons::setPriorityKey(uint8_t id, bool enabled)
+{
+  if (id >= _btnCount || !_map)
+    return false;
+
+  lock();
+  if (enabled)
+  {
+    _prioIds |= (1ul << id);
+  }
+  else
+  {
+    // Sin estado viejo: al re-habilitarla no sale un RELEASE de una tecla suelta
+    _prioIds &= ~(1ul << id);
+    _prioState &= ~(1ul << id);
+  }
+  unlock();
+
+  // Recompilar el plan (prioMask) y conmutarlo entre frames
+  return setMap(_map, _mapLen);
+}
+
+void JWMatrixButtons::setPriorityCallback(PriorityCallback cb, void *ctx)
+{
+  lock();
+  _prioCb = cb;
+  _prioCtx = ctx;
+  unlock();
+}
+
+uint32_t JWMatrixButtons::priorityLatencyMaxUs() const
+{
+  return _prioLatMaxUs;
+}
+
+void JWMatrixButtons::resetPriorityLatency()
+{
+  _prioLatMaxUs = 0;
+}
+
+void JWMatrixButtons::updatePriority()
+{
+  if (!_rowPins || !_colPins || !_prioIds)
+    return;
+
+  BtnEvent ev[PRIO_Q];
+  uint8_t n = 0;
+  uint32_t t0 = micros();
+
+  lock();
+  uint8_t raw[MAX_ROWS];
   for (uint8_t r = 0; r < _nRows; r++)
   {
-    pinMode(_rowPins[r], OUTPUT);
-    digitalWrite(_rowPins[r], LOW);
+    uint8_t cols = prioCols_(r);
+    raw[r] = 0;
+    if (!cols)
+      continue;
+
+    _backend->selectRow(r);
+    if (_settleUs)
+      delayMicroseconds(_settleUs);
+
+    raw[r] = readCols_(cols);
+  }
+  _backend->selectRow(JWMatrixBackend::ROW_NONE);
+  n = prioEval_(prioGather_(raw), ev);
+  unlock();
+
+  prioDispatch_(ev, n, t0);
+}
+
+uint8_t JWMatrixButtons::prioCols_(uint8_t r) const
+{
+  // Posiciones prioritarias del mapa activo + las sostenidas con id prioritario:
+  // si el mapa nuevo ya no tiene esa posición como prioritaria, la tecla sigue
+  // muestreada y su RELEASE llega al soltarla, no al cambiar de mapa
+  uint8_t cols = _plan[_planActive].prioMask[r];
+  uint8_t held = (uint8_t)(_heldMask[r] & ~cols);
+  while (held)
+  {
+    uint8_t c = (uint8_t)__builtin_ctz(held);
+    held &= (uint8_t)(held - 1);
+    uint8_t id = _heldId[r][c];
+    if (id < MAX_BTNS && (_prioIds & (1ul << id)))
+      cols |= (uint8_t)(1u << c);
   }
-  for (uint8_t c = 0; c < _nCols; c++)
+  return cols;
+}
+
+uint32_t JWMatrixButtons::prioGather_(const uint8_t raw[MAX_ROWS]) const
+{
+  // raw por posición -> bit por id (una posición sostenida mantiene su id aunque
+  // haya cambiado el mapa)
+  const ScanPlan &plan = _plan[_planActive];
+  uint32_t ids = 0;
+  for (uint8_t r = 0; r < _nRows; r++)
   {
-    pinMode(_colPins[c], INPUT);
+    uint8_t bits = (uint8_t)(raw[r] & prioCols_(r));
+    while (bits)
+    {
+      uint8_t c = (uint8_t)__builtin_ctz(bits);
+      bits &= (uint8_t)(bits - 1);
+      uint8_t id = (_heldId[r][c] < UNMAPPED) ? _heldId[r][c] : plan.id[r][c];
+      if (id < MAX_BTNS)
+        ids |= (1ul << id);
+    }
   }
+  return ids;
+}
+
+uint8_t JWMatrixButtons::prioEval_(uint32_t rawIds, BtnEvent out[PRIO_Q])
+{
+  // Debounce eager: el primer flanco pasa al instante; después, cambios
+  // dentro de debounceMs se ignoran (rebote)
+  uint32_t now = millis();
+  uint32_t diff = (rawIds ^ _prioState) & _prioIds;
+  uint8_t n = 0;
+
+  while (diff && n < PRIO_Q)
+  {
+    uint8_t id = (uint8_t)__builtin_ctzl(diff);
+    diff &= diff - 1;
+
+    if ((now - _prioEdgeAt[id]) < _debounceMs)
+      continue;
+
+    _prioEdgeAt[id] = now;
+    _prioState ^= (1ul << id);
+
+    out[n].id = id;
+    out[n].type = (_prioState & (1ul << id)) ? EV_PRESS : EV_RELEASE;
+    out[n].mult = 0;
+    out[n].held_ms = 0;
+    n++;
+  }
+  return n;
+}
+
+void JWMatrixButtons::prioDispatch_(const BtnEvent ev[], uint8_t n, uint32_t t0Us)
+{
+  if (!n)
+    return;
 
   lock();
-  resetStates();
-  _evN = 0;
+  PriorityCallback cb = _prioCb;
+  void *ctx = _prioCtx;
+  unlock();
+
+  uint32_t lat = micros() - t0Us;
+  if (lat > _prioLatMaxUs)
+    _prioLatMaxUs = lat;
+
+  if (!cb)
+    return;
+  for (uint8_t i = 0; i < n; i++)
+    cb(ev[i].id, ev[i].type, ctx);
+}
+#endif
+
+#if JWMB_ENABLE_ENCODER
+// =========================
+// Encoders
+// =========================
+
+#ifndef ARDUINO_ISR_ATTR
+  #define ARDUINO_ISR_ATTR
+#endif
+
+// Tabla full-step (estado x AB). Un detent = 11 -> 01 -> 00 -> 10 -> 11 (inc) o
+// el inverso (dec); un rebote solo va y vuelve entre estados vecinos.
+enum : uint8_t
+{
+  ENC_START = 0,
+  ENC_CW_FINAL,
+  ENC_CW_BEGIN,
+  ENC_CW_NEXT,
+  ENC_CCW_BEGIN,
+  ENC_CCW_FINAL,
+  ENC_CCW_NEXT,
+  ENC_DIR_CW = 0x10,
+  ENC_DIR_CCW = 0x20
+};
+
+static const uint8_t ENC_TABLE[7][4] = {
+    // AB:   00            01             10             11
+    {ENC_START, ENC_CW_BEGIN, ENC_CCW_BEGIN, ENC_START},                   // START
+    {ENC_CW_NEXT, ENC_START, ENC_CW_FINAL, ENC_START | ENC_DIR_CW},        // CW_FINAL
+    {ENC_CW_NEXT, ENC_CW_BEGIN, ENC_START, ENC_START},                     // CW_BEGIN
+    {ENC_CW_NEXT, ENC_CW_BEGIN, ENC_CW_FINAL, ENC_START},                  // CW_NEXT
+    {ENC_CCW_NEXT, ENC_START, ENC_CCW_BEGIN, ENC_START},                   // CCW_BEGIN
+    {ENC_CCW_NEXT, ENC_CCW_FINAL, ENC_START, ENC_START | ENC_DIR_CCW},     // CCW_FINAL
+    {ENC_CCW_NEXT, ENC_CCW_FINAL, ENC_CCW_BEGIN, ENC_START},               // CCW_NEXT
+};
+
+// Sin detents por más de esto, el siguiente arranca lento (paso s1)
+static const uint16_t ENC_IDLE_MS = 250;
+
+bool JWMatrixButtons::addEncoder(uint8_t pinA, uint8_t pinB, uint8_t decId, uint8_t incId,
+                                 bool useInterrupt)
+{
+  if (decId >= _btnCount || incId >= _btnCount || decId == incId)
+    return false;
+  if (_encN >= MAX_ENCODERS)
+    return false;
+
+  bool hasPins = (pinA != ENC_NO_PIN && pinB != ENC_NO_PIN);
+#if !defined(ARDUINO)
+  if (hasPins)
+    return false; // sin GPIO propio: usar ENC_NO_PIN + encoderInput()
+#endif
+#if !defined(ARDUINO_ARCH_ESP32)
+  if (useInterrupt)
+    return false;
+#endif
+  if (useInterrupt && !hasPins)
+    return false;
+
+  lock();
+  uint8_t ch = _encN;
+  EncoderCh &e = _enc[ch];
+  e.pinA = pinA;
+  e.pinB = pinB;
+  e.decId = decId;
+  e.incId = incId;
+  e.isr = useInterrupt;
+  e.state = ENC_START;
+  e.cw = e.ccw = 0;
+  e.seenCw = e.seenCcw = 0;
+  e.lastDir = 0;
+  e.intervalMs = 0;
+  e.lastAt = 0;
+#if JWMB_ENABLE_AXIS
+  for (uint8_t s = 0; s < 2; s++)
+  {
+    e.pendN[s] = 0;
+    e.pendAmt[s] = 0;
+    e.pendStep[s] = 0;
+  }
+#endif
+
+#if defined(ARDUINO)
+  if (hasPins)
+  {
+    pinMode(pinA, INPUT_PULLUP);
+    pinMode(pinB, INPUT_PULLUP);
+    if (!useInterrupt)
+      _encPolled |= (uint8_t)(1u << ch);
+  }
+#endif
+  _encN++;
   unlock();
+
+#if defined(ARDUINO_ARCH_ESP32)
+  if (useInterrupt)
+  {
+    attachInterruptArg(digitalPinToInterrupt(pinA), encIsr_, &_enc[ch], CHANGE);
+    attachInterruptArg(digitalPinToInterrupt(pinB), encIsr_, &_enc[ch], CHANGE);
+  }
+#endif
   return true;
 }
 
+void JWMatrixButtons::clearEncoders()
+{
+#if defined(ARDUINO_ARCH_ESP32)
+  for (uint8_t i = 0; i < _encN; i++)
+  {
+    if (_enc[i].isr)
+    {
+      detachInterrupt(digitalPinToInterrupt(_enc[i].pinA));
+      detachInterrupt(digitalPinToInterrupt(_enc[i].pinB));
+    }
+  }
+#endif
+  lock();
+  _encN = 0;
+  _encPolled = 0;
+  unlock();
+}
+
+void JWMatrixButtons::setEncoderProfile(uint16_t rate1, uint16_t rate2, uint16_t rate3,
+                                        int16_t s1, int16_t s2, int16_t s3, int16_t s4)
+{
+  lock();
+  _encR1 = rate1;
+  _encR2 = rate2;
+  _encR3 = rate3;
+  _encS1 = s1;
+  _encS2 = s2;
+  _encS3 = s3;
+  _encS4 = s4;
+  unlock();
+}
+
+void JWMatrixButtons::encoderInput(uint8_t ch, bool a, bool b)
+{
+  if (ch >= _encN)
+    return;
+  encStep_(_enc[ch], (uint8_t)((b ? 2u : 0u) | (a ? 1u : 0u)));
+}
+
+void ARDUINO_ISR_ATTR JWMatrixButtons::encStep_(EncoderCh &e, uint8_t ab)
+{
+  uint8_t st = ENC_TABLE[e.state & 0x0F][ab & 0x03];
+  e.state = (uint8_t)(st & 0x0F);
+  if (st & ENC_DIR_CW)
+    e.cw = (uint16_t)(e.cw + 1);
+  else if (st & ENC_DIR_CCW)
+    e.ccw = (uint16_t)(e.ccw + 1);
+}
+
+#if defined(ARDUINO_ARCH_ESP32)
+void ARDUINO_ISR_ATTR JWMatrixButtons::encIsr_(void *arg)
+{
+  EncoderCh &e = *static_cast<EncoderCh *>(arg);
+  encStep_(e, (uint8_t)((digitalRead(e.pinB) ? 2u : 0u) | (digitalRead(e.pinA) ? 1u : 0u)));
+}
+#endif
+
+void JWMatrixButtons::pollEncoders_()
+{
+#if defined(ARDUINO)
+  uint8_t m = _encPolled;
+  while (m)
+  {
+    uint8_t i = (uint8_t)__builtin_ctz(m);
+    m &= (uint8_t)(m - 1);
+    EncoderCh &e = _enc[i];
+    encStep_(e, (uint8_t)((digitalRead(e.pinB) ? 2u : 0u) | (digitalRead(e.pinA) ? 1u : 0u)));
+  }
+#endif
+}
+
+void JWMatrixButtons::emitEncoders_(uint32_t now)
+{
+  for (uint8_t i = 0; i < _encN; i++)
+  {
+    EncoderCh &e = _enc[i];
+    uint16_t cw = e.cw;
+    uint16_t ccw = e.ccw;
+    uint16_t nInc = (uint16_t)(cw - e.seenCw);
+    uint16_t nDec = (uint16_t)(ccw - e.seenCcw);
+    e.seenCw = cw;
+    e.seenCcw = ccw;
+
+    // Neto del frame (un rebote entre frames se cancela solo)
+    int32_t net = (int32_t)nInc - (int32_t)nDec;
+    if (net == 0)
+      continue;
+    int8_t dir = (net > 0) ? 1 : -1;
+    uint16_t n = (uint16_t)((net > 0) ? net : -net);
+
+    // Velocidad: intervalo entre detents suavizado; al invertir o tras una
+    // pausa se vuelve a empezar lento
+    uint32_t dt = now - e.lastAt;
+    uint32_t iv = dt / n;
+    if (iv > 0xFFFFu)
+      iv = 0xFFFFu;
+    if (dir != e.lastDir || dt > ENC_IDLE_MS)
+      e.intervalMs = ENC_IDLE_MS;
+    else
+      e.intervalMs = (uint16_t)((3u * e.intervalMs + iv) / 4u);
+    e.lastDir = dir;
+    e.lastAt = now;
+
+    uint32_t rate = e.intervalMs ? (1000u / e.intervalMs) : 1000u;
+    int16_t step = _encS1;
+    if (rate >= _encR3)
+      step = _encS4;
+    else if (rate >= _encR2)
+      step = _encS3;
+    else if (rate >= _encR1)
+      step = _encS2;
+
+    // Un evento por frame y sentido: 40 detents en un frame no llenan el log
+    uint16_t stepU = (step > 0) ? (uint16_t)step : 1u;
+    uint32_t amt = (uint32_t)stepU * n;
+    uint8_t id = (dir > 0) ? e.incId : e.decId;
+    pushEvent(id, EV_DETENT, (int16_t)(amt > 32767u ? 32767u : amt), iv);
+
+#if JWMB_ENABLE_AXIS
+    uint8_t s = (dir > 0) ? 1 : 0;
+    e.pendN[s] = (uint16_t)((e.pendN[s] + n > 0xFFFFu) ? 0xFFFFu : e.pendN[s] + n);
+    e.pendAmt[s] = (e.pendAmt[s] > 0xFFFFFFFFu - amt) ? 0xFFFFFFFFu : e.pendAmt[s] + amt;
+    e.pendStep[s] = (int16_t)stepU;
+#endif
+  }
+}
+
+#if JWMB_ENABLE_AXIS
+void JWMatrixButtons::takeDetents_(uint8_t id, bool isInc, uint16_t &n, uint32_t &amt,
+                                   int16_t &step) const
+{
+  // Llamar con lock. Suma (y vacía) lo pendiente de los encoders con ese id.
+  n = 0;
+  amt = 0;
+  step = 0;
+  uint8_t s = isInc ? 1 : 0;
+  for (uint8_t i = 0; i < _encN; i++)
+  {
+    const EncoderCh &e = _enc[i];
+    if ((isInc ? e.incId : e.decId) != id || !e.pendN[s])
+      continue;
+    n = (uint16_t)((n + e.pendN[s] > 0xFFFFu) ? 0xFFFFu : n + e.pendN[s]);
+    amt = (amt > 0xFFFFFFFFu - e.pendAmt[s]) ? 0xFFFFFFFFu : amt + e.pendAmt[s];
+    step = e.pendStep[s];
+    e.pendN[s] = 0;
+    e.pendAmt[s] = 0;
+  }
+}
+#endif
+#endif
+
 void JWMatrixButtons::setScanDelays(uint16_t settleUs, uint16_t betweenRowsUs)
 {
   lock();
   _settleUs = settleUs;
   _betweenRowsUs = betweenRowsUs;
+  if (_backend)
+    _backend->setSettleUs(settleUs);
   unlock();
 }
 
+#if JWMB_ENABLE_REPEAT
 void JWMatrixButtons::setRepeatEnabled(uint8_t id, bool enabled)
 {
   if (id >= _btnCount)
     return;
   lock();
-  _repeatEnabled[id] = enabled;
+  if (enabled)
+    _repeatMask |= (1ul << id);
+  else
+    _repeatMask &= ~(1ul << id);
   unlock();
 }
 
@@ -114,6 +792,7 @@ void JWMatrixButtons::setRepeatProfile(uint16_t thr1, uint16_t thr2, uint16_t th
   _d4 = d4;
   unlock();
 }
+#endif
 
 // =========================
 // ESP32 task
@@ -121,7 +800,7 @@ void JWMatrixButtons::setRepeatProfile(uint16_t thr1, uint16_t thr2, uint16_t th
 
 bool JWMatrixButtons::startTask(uint8_t core, uint32_t stackBytes, uint8_t priority, uint16_t periodMs)
 {
-#if !defined(ARDUINO_ARCH_ESP32)
+#if !JWMB_HAS_RTOS
   (void)core;
   (void)stackBytes;
   (void)priority;
@@ -169,7 +848,7 @@ bool JWMatrixButtons::startTask(uint8_t core, uint32_t stackBytes, uint8_t prior
 
 void JWMatrixButtons::stopTask()
 {
-#if defined(ARDUINO_ARCH_ESP32)
+#if JWMB_HAS_RTOS
   if (!_taskHandle)
     return;
 
@@ -189,7 +868,7 @@ void JWMatrixButtons::stopTask()
 
 bool JWMatrixButtons::taskRunning() const
 {
-#if defined(ARDUINO_ARCH_ESP32)
+#if JWMB_HAS_RTOS
   return _taskHandle != nullptr;
 #else
   return false;
@@ -198,7 +877,7 @@ bool JWMatrixButtons::taskRunning() const
 
 void JWMatrixButtons::setTaskPeriodMs(uint16_t periodMs)
 {
-#if defined(ARDUINO_ARCH_ESP32)
+#if JWMB_HAS_RTOS
   _taskPeriod = periodMs;
 #else
   (void)periodMs;
@@ -207,21 +886,59 @@ void JWMatrixButtons::setTaskPeriodMs(uint16_t periodMs)
 
 uint16_t JWMatrixButtons::taskPeriodMs() const
 {
-#if defined(ARDUINO_ARCH_ESP32)
+#if JWMB_HAS_RTOS
   return (uint16_t)_taskPeriod;
 #else
   return 0;
 #endif
 }
 
-#if defined(ARDUINO_ARCH_ESP32)
+#if JWMB_HAS_RTOS
 void JWMatrixButtons::taskTrampoline(void *arg)
 {
   JWMatrixButtons *self = static_cast<JWMatrixButtons *>(arg);
   while (self && self->_taskRun)
   {
     self->update();
-    vTaskDelay(pdMS_TO_TICKS(self->_taskPeriod));
+
+    uint16_t period = self->_taskPeriod;
+#if JWMB_ENABLE_SCAN_GROUPS
+    // Con grupos de escaneo: despertar al ritmo del grupo más rápido
+    period = self->schedTickMs_();
+#endif
+
+    // Con teclas prioritarias o encoders por polling: muestrearlos cada ~1 ms
+    // entre update()
+    bool fast = false;
+#if JWMB_ENABLE_PRIORITY
+    fast = fast || self->_prioIds;
+#endif
+#if JWMB_ENABLE_ENCODER
+    fast = fast || self->_encPolled;
+#endif
+    if (fast)
+    {
+      TickType_t slice = pdMS_TO_TICKS(1);
+      if (slice == 0)
+        slice = 1;
+      for (uint16_t ms = 0; ms < period && self->_taskRun; ms++)
+      {
+        vTaskDelay(slice);
+#if JWMB_ENABLE_PRIORITY
+        self->updatePriority();
+#endif
+#if JWMB_ENABLE_ENCODER
+        if (self->_encPolled)
+        {
+          self->lock();
+          self->pollEncoders_();
+          self->unlock();
+        }
+#endif
+      }
+      continue;
+    }
+    vTaskDelay(pdMS_TO_TICKS(period));
   }
 
   if (self)
@@ -235,6 +952,7 @@ void JWMatrixButtons::taskTrampoline(void *arg)
 // Eventos / estado
 // =========================
 
+#if JWMB_ENABLE_EVENT_LOG
 uint8_t JWMatrixButtons::eventCount() const
 {
   lock();
@@ -255,17 +973,19 @@ bool JWMatrixButtons::getEvent(uint8_t index, BtnEvent &out) const
   unlock();
   return true;
 }
+#endif
 
 bool JWMatrixButtons::isDown(uint8_t id) const
 {
   if (id >= _btnCount)
     return false;
   lock();
-  bool v = _btnStable[id];
+  bool v = (_btnStable >> id) & 1u;
   unlock();
   return v;
 }
 
+#if JWMB_ENABLE_LATCHES
 bool JWMatrixButtons::pressed(uint8_t id) const
 {
   if (id >= _btnCount)
@@ -289,6 +1009,7 @@ bool JWMatrixButtons::released(uint8_t id) const
   unlock();
   return ok;
 }
+#endif
 
 // =========================
 // Core scanning
@@ -299,227 +1020,582 @@ void JWMatrixButtons::update()
   if (!_rowPins || !_colPins || _nRows == 0 || _nCols == 0)
     return;
 
-  lock();
+#if JWMB_ENABLE_PRIORITY
+  BtnEvent prioEv[PRIO_Q];
+  uint8_t prioN = 0;
+  uint32_t t0 = micros();
+#endif
+
+  lock();
+
+#if JWMB_ENABLE_ENCODER
+  pollEncoders_();
+#endif
+
+  // 1) columnas a escanear en este tick (solo las del plan; con grupos, solo
+  //    las de los grupos que tocan)
+  uint8_t cols[MAX_ROWS];
+  uint8_t any = 0;
+#if JWMB_ENABLE_SCAN_GROUPS
+  uint8_t due = dueGroups_(millis());
+  for (uint8_t r = 0; r < _nRows; r++)
+  {
+    cols[r] = 0;
+    uint8_t d = due;
+    while (d)
+    {
+      uint8_t g = (uint8_t)__builtin_ctz(d);
+      d &= (uint8_t)(d - 1);
+      cols[r] |= groupCols_(g, r);
+    }
+    any |= cols[r];
+  }
+#else
+  for (uint8_t r = 0; r < _nRows; r++)
+  {
+    cols[r] = scanCols_(r);
+    any |= cols[r];
+  }
+#endif
+
+  // 1b) scan raw. En reposo, si el backend sabe que no hubo actividad (INT de
+  //     un expansor), no se toca el hardware.
+  bool scan = any && !idle_();
+  if (any && !scan)
+  {
+#if JWMB_ENABLE_SCAN_GROUPS
+    // Con grupos, la lectura de los grupos que tocan ya limpia el aviso del
+    // backend: se sigue escaneando hasta que hayan pasado todos los grupos
+    if (!_wakeGrp && _backend->activityPending())
+      _wakeGrp = _plan[_planActive].grpUsed;
+    scan = (_wakeGrp != 0);
+#else
+    scan = _backend->activityPending();
+#endif
+  }
+  if (scan)
+    scanRaw(_raw, cols);
+#if JWMB_ENABLE_SCAN_GROUPS
+  _wakeGrp &= (uint8_t)~due;
+#endif
 
-  // 1) scan raw
-  scanRaw(_raw);
+#if JWMB_ENABLE_PRIORITY
+  // 1b) teclas prioritarias: mismo raw, sin I/O extra
+  if (_prioIds)
+    prioN = prioEval_(prioGather_(_raw), prioEv);
+#endif
 
-  // 2) debounce
-  uint32_t now = millis();
+  // 2) debounce (solo posiciones escaneadas en este tick)
+#if JWMB_ENABLE_SCAN_GROUPS
+  while (due)
+  {
+    uint8_t g = (uint8_t)__builtin_ctz(due);
+    due &= (uint8_t)(due - 1);
+    uint32_t db = g ? _grp[g].debounceMs : _debounceMs;
+    for (uint8_t r = 0; r < _nRows; r++)
+    {
+      uint8_t m = groupCols_(g, r);
+      while (m)
+      {
+        uint8_t c = (uint8_t)__builtin_ctz(m);
+        m &= (uint8_t)(m - 1);
+        debounceUpdate(_keyDeb[r][c], (_raw[r] >> c) & 1u, db);
+      }
+    }
+  }
+#else
   for (uint8_t r = 0; r < _nRows; r++)
   {
-    for (uint8_t c = 0; c < _nCols; c++)
+    uint8_t m = cols[r];
+    while (m)
     {
-      debounceUpdate(_keyDeb[r][c], _raw[r][c]);
-      // estable
-      _deb[r][c] = _keyDeb[r][c].stable;
+      uint8_t c = (uint8_t)__builtin_ctz(m);
+      m &= (uint8_t)(m - 1);
+      debounceUpdate(_keyDeb[r][c], (_raw[r] >> c) & 1u, _debounceMs);
     }
   }
+#endif
 
   // 3) map to button ids
   mapButtons();
 
-  // 4) generate edges + repeats
+  // 4) generate edges + repeats (pushEvent() los registra y latchea)
+#if JWMB_ENABLE_EVENT_LOG
   _evN = 0;
+#endif
   emitEdgesAndRepeats();
+#if JWMB_ENABLE_ENCODER
+  emitEncoders_(millis());
+#endif
+
+  unlock();
+
+#if JWMB_ENABLE_PRIORITY
+  prioDispatch_(prioEv, prioN, t0);
+#endif
+}
+
+bool JWMatrixButtons::waitForActivity(uint32_t timeoutMs)
+{
+  if (!_rowPins || !_colPins)
+    return true;
 
-  // 5) latch events (para no perderlos)
-  for (uint8_t i = 0; i < _evN; i++)
+  lock();
+  if (!idle_())
   {
-    latchEvent_(_events[i]);
+    unlock();
+    return true;
   }
 
+  uint8_t allCols = 0;
+  const ScanPlan &plan = _plan[_planActive];
+  for (uint8_t r = 0; r < _nRows; r++)
+    allCols |= plan.colMask[r];
+
+  // Todas las filas activas: cualquier tecla poblada se ve en su columna
+  _backend->selectRow(JWMatrixBackend::ROW_ALL);
+  if (_settleUs)
+    delayMicroseconds(_settleUs);
+  bool active = readCols_(allCols) != 0;
+  unlock();
+
+  bool ev = active || _backend->waitColEdge(timeoutMs);
+
+  lock();
+  _backend->selectRow(JWMatrixBackend::ROW_NONE);
   unlock();
-  (void)now;
+  return ev;
+}
+
+bool JWMatrixButtons::idle_() const
+{
+  // Reposo = nada crudo activo ni teclas sostenidas/soltándose
+  for (uint8_t r = 0; r < _nRows; r++)
+  {
+    if (_raw[r] || _heldMask[r])
+      return false;
+  }
+  return true;
 }
 
 void JWMatrixButtons::resetStates()
 {
+#if JWMB_ENABLE_PRIORITY
+  _prioIds = 0;
+  _prioState = 0;
+#endif
+
+#if JWMB_ENABLE_SCAN_GROUPS
+  for (uint8_t g = 0; g < MAX_SCAN_GROUPS; g++)
+  {
+    _grp[g].next = 0;
+    _grp[g].debounceMs = _debounceMs;
+    _grp[g].periodMs = 0;
+  }
+  for (uint8_t r = 0; r < MAX_ROWS; r++)
+    _rowGroup[r] = 0;
+  for (uint8_t i = 0; i < MAX_BTNS; i++)
+    _keyGroup[i] = GROUP_OF_ROW;
+  _wakeGrp = 0;
+#endif
+
+  _btnStable = 0;
+  _btnPrev = 0;
+#if JWMB_ENABLE_REPEAT
+  _repeatMask = 0;
+#endif
+
   for (uint8_t r = 0; r < MAX_ROWS; r++)
   {
+    _raw[r] = 0;
+    _heldMask[r] = 0;
     for (uint8_t c = 0; c < MAX_COLS; c++)
     {
-      _raw[r][c] = false;
-      _deb[r][c] = false;
       _keyDeb[r][c].stable = false;
       _keyDeb[r][c].lastRaw = false;
       _keyDeb[r][c].lastChange = 0;
+#if JWMB_ENABLE_DIAGNOSTICS
+      resetHealth_(_keyDeb[r][c]);
+#endif
+      _heldId[r][c] = NO_ID;
     }
   }
 
   for (uint8_t i = 0; i < MAX_BTNS; i++)
   {
-    _btnStable[i] = false;
-    _btnPrev[i] = false;
-    _btnPressStart[i] = 0;
+    _btnT[i] = BtnTiming();
 
-    _repeatEnabled[i] = false;
-    _nextRepeatAt[i] = 0;
-    _repeatCount[i] = 0;
+#if JWMB_ENABLE_PRIORITY
+    _prioEdgeAt[i] = 0;
+#endif
 
+#if JWMB_ENABLE_LATCHES
     _pressPend[i] = 0;
     _releasePend[i] = 0;
+#if JWMB_ENABLE_REPEAT
     _repHead[i] = 0;
     _repTail[i] = 0;
     _repCountPend[i] = 0;
     for (uint8_t k = 0; k < REPEAT_Q; k++)
       _repQ[i][k] = 0;
+#endif
+#endif
   }
 }
 
-bool JWMatrixButtons::readCol(uint8_t pin) const
+void JWMatrixButtons::scanRaw(uint8_t raw[MAX_ROWS], const uint8_t scan[MAX_ROWS])
 {
-  int v = digitalRead(pin);
-  return _invert ? (v == LOW) : (v == HIGH);
-}
-
-void JWMatrixButtons::scanRaw(bool raw[MAX_ROWS][MAX_COLS])
-{
-  // filas una por una
+  // filas una por una; solo las que tienen columnas que escanear en este tick.
+  // Las demás filas quedan en reposo y conservan su último raw.
   for (uint8_t r = 0; r < _nRows; r++)
   {
+    uint8_t cols = scan[r];
+    raw[r] &= (uint8_t)(scanCols_(r) & ~cols); // fuera del plan: 0
+    if (!cols)
+      continue;
+
     // activar solo esta fila
-    for (uint8_t rr = 0; rr < _nRows; rr++)
-      digitalWrite(_rowPins[rr], (rr == r) ? HIGH : LOW);
+    _backend->selectRow(r);
 
     if (_settleUs)
       delayMicroseconds(_settleUs);
 
-    for (uint8_t c = 0; c < _nCols; c++)
-      raw[r][c] = readCol(_colPins[c]);
+    // gather: solo columnas usadas en esta fila (una lectura del backend)
+    raw[r] |= readCols_(cols);
+
+    _backend->selectRow(JWMatrixBackend::ROW_NONE);
 
     if (_betweenRowsUs)
       delayMicroseconds(_betweenRowsUs);
   }
-
-  // apagar filas
-  for (uint8_t rr = 0; rr < _nRows; rr++)
-    digitalWrite(_rowPins[rr], LOW);
 }
 
-void JWMatrixButtons::debounceUpdate(DebouncedKey &k, bool rawNow)
+void JWMatrixButtons::debounceUpdate(DebouncedKey &k, bool rawNow, uint32_t debounceMs)
 {
   uint32_t now = millis();
+  bool edge = (rawNow != k.lastRaw);
 
-  if (rawNow != k.lastRaw)
+  if (edge)
   {
     k.lastRaw = rawNow;
     k.lastChange = now;
   }
 
-  if ((now - k.lastChange) >= _debounceMs)
+#if JWMB_ENABLE_DIAGNOSTICS
+  bool wasStable = k.stable;
+#endif
+  bool settled = ((now - k.lastChange) >= debounceMs);
+  if (settled)
   {
     k.stable = rawNow;
   }
+
+#if JWMB_ENABLE_DIAGNOSTICS
+  healthUpdate_(k, edge, settled, wasStable, now);
+#endif
+}
+
+#if JWMB_ENABLE_DIAGNOSTICS
+// =========================
+// Diagnóstico por tecla
+// =========================
+
+void JWMatrixButtons::healthUpdate_(DebouncedKey &k, bool edge, bool settled, bool wasStable, uint32_t now)
+{
+  KeyHealth &h = k.health;
+
+  if (edge)
+  {
+    if (k.bounceEdges == 0)
+      k.bounceStart = now;
+    if (k.bounceEdges < 255)
+      k.bounceEdges++;
+  }
+
+  if (k.bounceEdges)
+  {
+    if (settled)
+    {
+      // Fin del cambio: duración = primer a último flanco
+      uint32_t dur = k.lastChange - k.bounceStart;
+      uint8_t bin;
+      if (k.bounceEdges == 1)
+        bin = 0;
+      else if (dur <= 1)
+        bin = 1;
+      else if (dur <= 2)
+        bin = 2;
+      else if (dur <= 5)
+        bin = 3;
+      else if (dur <= 10)
+        bin = 4;
+      else if (dur <= 20)
+        bin = 5;
+      else if (dur <= 50)
+        bin = 6;
+      else
+        bin = 7;
+      if (h.bounceHist[bin] < 0xFFFF)
+        h.bounceHist[bin]++;
+
+      if (k.bounceEdges > h.maxEdges)
+        h.maxEdges = k.bounceEdges;
+
+      if (k.stable && !wasStable)
+      {
+        if (h.presses < 0xFFFF)
+          h.presses++;
+        h.pressEdges += k.bounceEdges;
+      }
+
+      k.bounceEdges = 0;
+      k.diagFlags &= (uint8_t)~DIAG_UNSETTLED;
+    }
+    else if (!(k.diagFlags & DIAG_UNSETTLED) && (now - k.bounceStart) >= _unsettledMs)
+    {
+      // Chatter: sigue rebotando sin asentarse
+      k.diagFlags |= DIAG_UNSETTLED;
+      if (h.unsettled < 0xFFFF)
+        h.unsettled++;
+    }
+  }
+
+  // Pegada: sostenida más de stuckMs (se cuenta una vez por pulsación)
+  if (!k.stable)
+  {
+    k.diagFlags &= (uint8_t)~DIAG_STUCK;
+  }
+  else if (!(k.diagFlags & DIAG_STUCK) && (now - k.lastChange) >= _stuckMs)
+  {
+    k.diagFlags |= DIAG_STUCK;
+    if (h.stuckEvents < 255)
+      h.stuckEvents++;
+  }
+}
+
+void JWMatrixButtons::resetHealth_(DebouncedKey &k)
+{
+  k.bounceStart = 0;
+  k.bounceEdges = 0;
+  k.diagFlags = 0;
+  k.health = KeyHealth();
+}
+
+void JWMatrixButtons::setHealthThresholds(uint32_t stuckMs, uint32_t unsettledMs)
+{
+  lock();
+  _stuckMs = stuckMs;
+  _unsettledMs = unsettledMs;
+  unlock();
+}
+
+bool JWMatrixButtons::getKeyHealth(uint8_t row, uint8_t col, KeyHealth &out) const
+{
+  if (row >= _nRows || col >= _nCols)
+    return false;
+
+  lock();
+  const DebouncedKey &k = _keyDeb[row][col];
+  out = k.health;
+  uint32_t now = millis();
+  out.stuck = (k.diagFlags & DIAG_STUCK) != 0;
+  out.settling = (k.diagFlags & DIAG_UNSETTLED) != 0;
+  out.heldMs = k.stable ? (now - k.lastChange) : 0;
+  unlock();
+  return true;
+}
+
+bool JWMatrixButtons::getButtonHealth(uint8_t id, KeyHealth &out) const
+{
+  if (id >= _btnCount)
+    return false;
+
+  lock();
+  const ScanPlan &plan = _plan[_planActive];
+  int8_t row = -1, col = -1;
+  for (uint8_t r = 0; r < _nRows && row < 0; r++)
+  {
+    uint8_t cols = plan.colMask[r];
+    while (cols)
+    {
+      uint8_t c = (uint8_t)__builtin_ctz(cols);
+      cols &= (uint8_t)(cols - 1);
+      if (plan.id[r][c] == id)
+      {
+        row = (int8_t)r;
+        col = (int8_t)c;
+        break;
+      }
+    }
+  }
+  unlock();
+
+  if (row < 0)
+    return false;
+  return getKeyHealth((uint8_t)row, (uint8_t)col, out);
+}
+
+void JWMatrixButtons::resetHealth()
+{
+  lock();
+  for (uint8_t r = 0; r < MAX_ROWS; r++)
+    for (uint8_t c = 0; c < MAX_COLS; c++)
+      resetHealth_(_keyDeb[r][c]);
+  unlock();
 }
+#endif
 
 void JWMatrixButtons::mapButtons()
 {
-  // reset
-  for (uint8_t i = 0; i < _btnCount; i++)
-    _btnStable[i] = false;
+  uint32_t stable = 0;
 
-  for (uint8_t i = 0; i < _mapLen; i++)
+  // Cada posición queda ligada al id que tenía al presionarse, hasta soltarse:
+  // así un cambio de mapa/capa no suelta ni presiona teclas sostenidas.
+  const ScanPlan &plan = _plan[_planActive];
+  for (uint8_t r = 0; r < _nRows; r++)
   {
-    const BtnMapItem &m = _map[i];
-    if (m.id >= _btnCount)
-      continue;
-    if (m.row >= _nRows || m.col >= _nCols)
-      continue;
+    uint8_t cols = scanCols_(r);
+    while (cols)
+    {
+      uint8_t c = (uint8_t)__builtin_ctz(cols);
+      cols &= (uint8_t)(cols - 1);
 
-    _btnStable[m.id] = _deb[m.row][m.col];
+      uint8_t &held = _heldId[r][c];
+      uint8_t bit = (uint8_t)(1u << c);
+      if (!_keyDeb[r][c].stable)
+      {
+        held = NO_ID;
+        _heldMask[r] &= (uint8_t)~bit;
+        continue;
+      }
+
+      if (held == NO_ID)
+      {
+        held = (plan.id[r][c] != NO_ID) ? plan.id[r][c] : UNMAPPED;
+        _heldMask[r] |= bit;
+      }
+      if (held != UNMAPPED)
+        stable |= (1ul << held);
+    }
   }
+  _btnStable = stable;
 }
 
 void JWMatrixButtons::pushEvent(uint8_t id, EvType type, int16_t mult, uint32_t held)
 {
-  if (_evN >= MAX_EVENTS)
-    return;
-  _events[_evN].id = id;
-  _events[_evN].type = type;
-  _events[_evN].mult = mult;
-  _events[_evN].held_ms = held;
-  _evN++;
+  BtnEvent e;
+  e.id = id;
+  e.type = type;
+  e.mult = mult;
+  e.held_ms = held;
+
+#if JWMB_ENABLE_EVENT_LOG
+  if (_evN < MAX_EVENTS)
+    _events[_evN++] = e;
+#endif
+
+  // latch (para no perderlos aunque el log se llene)
+#if JWMB_ENABLE_LATCHES
+  latchEvent_(e);
+#else
+  (void)e;
+#endif
 }
 
 void JWMatrixButtons::emitEdgesAndRepeats()
 {
+  uint32_t cur = _btnStable;
+  uint32_t changed = cur ^ _btnPrev;
+  uint32_t work = changed;
+#if JWMB_ENABLE_REPEAT
+  work |= cur & _repeatMask;
+#endif
+  _btnPrev = cur;
+  if (!work)
+    return;
+
   uint32_t now = millis();
 
-  for (uint8_t id = 0; id < _btnCount; id++)
+  while (work)
   {
-    bool cur = _btnStable[id];
-    bool prev = _btnPrev[id];
+    uint8_t id = (uint8_t)__builtin_ctzl(work);
+    work &= work - 1;
+    uint32_t bit = 1ul << id;
+    BtnTiming &t = _btnT[id];
 
-    if (cur && !prev)
-    {
-      // PRESS
-      _btnPressStart[id] = now;
-      _repeatCount[id] = 0;
-      _nextRepeatAt[id] = now + _repeatInitialDelay;
-      pushEvent(id, EV_PRESS, 0, 0);
-    }
-    else if (!cur && prev)
+    if (changed & bit)
     {
-      // RELEASE
-      uint32_t held = (now >= _btnPressStart[id]) ? (now - _btnPressStart[id]) : 0;
-      pushEvent(id, EV_RELEASE, 0, held);
-      _repeatCount[id] = 0;
-      _nextRepeatAt[id] = 0;
+      if (cur & bit)
+      {
+        // PRESS
+        t.pressStart = now;
+#if JWMB_ENABLE_AXIS
+        t.pressSeq++;
+#endif
+#if JWMB_ENABLE_REPEAT
+        t.repeatCount = 0;
+        t.nextRepeatAt = now + _repeatInitialDelay;
+#endif
+        pushEvent(id, EV_PRESS, 0, 0);
+      }
+      else
+      {
+        // RELEASE
+        uint32_t held = (now >= t.pressStart) ? (now - t.pressStart) : 0;
+#if JWMB_ENABLE_AXIS
+        t.lastHeld = held;
+#endif
+        pushEvent(id, EV_RELEASE, 0, held);
+#if JWMB_ENABLE_REPEAT
+        t.repeatCount = 0;
+        t.nextRepeatAt = 0;
+#endif
+        continue;
+      }
     }
 
+#if JWMB_ENABLE_REPEAT
     // REPEAT
-    if (cur && _repeatEnabled[id])
+    if (!(_repeatMask & bit) || now < t.nextRepeatAt)
+      continue;
+
+    uint32_t held = (now >= t.pressStart) ? (now - t.pressStart) : 0;
+    int16_t step = _s1;
+    uint32_t delayMs = _d1;
+
+    if (t.repeatCount == 0)
     {
-      uint32_t held = (now >= _btnPressStart[id]) ? (now - _btnPressStart[id]) : 0;
+      // primer repeat
+      t.repeatCount = 1;
+    }
+    else
+    {
+      t.repeatCount++;
 
-      if (_repeatCount[id] == 0)
+      if (t.repeatCount >= _thr3)
       {
-        // primer repeat
-        if (now >= _nextRepeatAt[id])
-        {
-          _repeatCount[id] = 1;
-          int16_t step = _s1;
-          uint32_t delayMs = _d1;
-          _nextRepeatAt[id] = now + delayMs;
-          pushEvent(id, EV_REPEAT, step, held);
-        }
+        step = _s4;
+        delayMs = _d4;
       }
-      else
+      else if (t.repeatCount >= _thr2)
       {
-        if (now >= _nextRepeatAt[id])
-        {
-          _repeatCount[id]++;
-
-          int16_t step = _s1;
-          uint32_t delayMs = _d1;
-
-          if (_repeatCount[id] >= _thr3)
-          {
-            step = _s4;
-            delayMs = _d4;
-          }
-          else if (_repeatCount[id] >= _thr2)
-          {
-            step = _s3;
-            delayMs = _d3;
-          }
-          else if (_repeatCount[id] >= _thr1)
-          {
-            step = _s2;
-            delayMs = _d2;
-          }
-
-          _nextRepeatAt[id] = now + delayMs;
-          pushEvent(id, EV_REPEAT, step, held);
-        }
+        step = _s3;
+        delayMs = _d3;
+      }
+      else if (t.repeatCount >= _thr1)
+      {
+        step = _s2;
+        delayMs = _d2;
       }
     }
 
-    _btnPrev[id] = cur;
+    t.nextRepeatAt = now + delayMs;
+    pushEvent(id, EV_REPEAT, step, held);
+#endif
   }
 }
 
+#if JWMB_ENABLE_LATCHES
 // =========================
 // Latching helpers
 // =========================
@@ -539,12 +1615,17 @@ void JWMatrixButtons::latchEvent_(const BtnEvent &e)
     if (_releasePend[e.id] < 255)
       _releasePend[e.id]++;
   }
+#if JWMB_ENABLE_REPEAT
   else if (e.type == EV_REPEAT)
   {
     repQPush_(e.id, e.mult);
   }
+#endif
+  // EV_DETENT no se latchea: applyAxis() lo toma del encoder (takeDetents_())
 }
 
+#if JWMB_ENABLE_REPEAT
+
 void JWMatrixButtons::repQPush_(uint8_t id, int16_t mult) const
 {
   if (id >= _btnCount)
@@ -582,7 +1663,10 @@ bool JWMatrixButtons::repQPop_(uint8_t id, int16_t &mult) const
   n--;
   return true;
 }
+#endif
+#endif
 
+#if JWMB_ENABLE_AXIS
 // =========================
 // applyAxis
 // =========================
@@ -603,16 +1687,28 @@ bool JWMatrixButtons::applyAxis(uint32_t *val, uint32_t minv, uint32_t maxv,
   bool changed = false;
 
   // Consumir presses pendientes de los 2 botones
-  uint8_t decPress = 0, incPress = 0;
+  uint32_t decPress = 0, incPress = 0;
   lock();
   decPress = _pressPend[decId];
   incPress = _pressPend[incId];
   _pressPend[decId] = 0;
   _pressPend[incId] = 0;
+#if JWMB_ENABLE_ENCODER && !JWMB_ENABLE_REPEAT
+  // Sin cola de repeats: cada detent cuenta como un press (±1)
+  {
+    uint16_t n;
+    uint32_t amt;
+    int16_t step;
+    takeDetents_(decId, false, n, amt, step);
+    decPress += n;
+    takeDetents_(incId, true, n, amt, step);
+    incPress += n;
+  }
+#endif
   unlock();
 
   // --- PRESS: dec
-  for (uint8_t i = 0; i < decPress; i++)
+  for (uint32_t i = 0; i < decPress; i++)
   {
     if (v <= minv)
     {
@@ -630,7 +1726,7 @@ bool JWMatrixButtons::applyAxis(uint32_t *val, uint32_t minv, uint32_t maxv,
   }
 
   // --- PRESS: inc
-  for (uint8_t i = 0; i < incPress; i++)
+  for (uint32_t i = 0; i < incPress; i++)
   {
     if (v >= maxv)
     {
@@ -647,10 +1743,14 @@ bool JWMatrixButtons::applyAxis(uint32_t *val, uint32_t minv, uint32_t maxv,
     }
   }
 
-  // Consumir repeats (cola) y aplicarlos en orden
-  auto applyRepeatStep = [&](bool isInc, int16_t step) {
+#if JWMB_ENABLE_REPEAT
+  // Consumir repeats (cola) y aplicarlos en orden. amount = cuánto mover
+  // (0 = un paso); el snap usa step.
+  auto applyRepeatStep = [&](bool isInc, int16_t step, uint32_t amount) {
     if (step <= 0)
       step = 1;
+    if (amount == 0)
+      amount = (uint32_t)step;
 
     if (isInc)
     {
@@ -660,9 +1760,7 @@ bool JWMatrixButtons::applyAxis(uint32_t *val, uint32_t minv, uint32_t maxv,
       if (snapToStepOnRepeat)
         base = (step > 0) ? (uint32_t)((v / (uint32_t)step) * (uint32_t)step) : v;
 
-      uint32_t nv = base + (uint32_t)step;
-      if (nv > maxv)
-        nv = maxv;
+      uint32_t nv = (amount > maxv - base) ? maxv : base + amount;
       if (nv != v)
       {
         v = nv;
@@ -679,8 +1777,8 @@ bool JWMatrixButtons::applyAxis(uint32_t *val, uint32_t minv, uint32_t maxv,
 
       // base podría ser menor que v, pero aquí solo usamos base como punto de salto
       uint32_t nv;
-      if (base >= (uint32_t)step)
-        nv = base - (uint32_t)step;
+      if (base >= amount)
+        nv = base - amount;
       else
         nv = 0;
 
@@ -705,7 +1803,7 @@ bool JWMatrixButtons::applyAxis(uint32_t *val, uint32_t minv, uint32_t maxv,
     unlock();
     if (!ok)
       break;
-    applyRepeatStep(false, step);
+    applyRepeatStep(false, step, 0);
   }
 
   for (;;)
@@ -716,9 +1814,195 @@ bool JWMatrixButtons::applyAxis(uint32_t *val, uint32_t minv, uint32_t maxv,
     unlock();
     if (!ok)
       break;
-    applyRepeatStep(true, step);
+    applyRepeatStep(true, step, 0);
+  }
+
+#if JWMB_ENABLE_ENCODER
+  // Detents acumulados por los encoders: snap con el paso del último frame y
+  // el total de una vez (igual que aplicarlos de a uno)
+  {
+    uint16_t n;
+    uint32_t amt;
+    int16_t step;
+    lock();
+    takeDetents_(decId, false, n, amt, step);
+    unlock();
+    if (n)
+      applyRepeatStep(false, step, amt);
+    lock();
+    takeDetents_(incId, true, n, amt, step);
+    unlock();
+    if (n)
+      applyRepeatStep(true, step, amt);
   }
+#endif
+#else
+  (void)snapToStepOnRepeat;
+#endif
 
   *val = v;
   return changed;
 }
+
+// =========================
+// applyRamp
+// =========================
+
+void JWMatrixButtons::setRampProfile(uint32_t delayMs,
+                                     uint32_t rate1, uint32_t t1Ms,
+                                     uint32_t rate2, uint32_t t2Ms,
+                                     uint32_t rate3, uint32_t t3Ms,
+                                     uint32_t rate4)
+{
+  // Tramos en orden creciente
+  if (t1Ms < delayMs)
+    t1Ms = delayMs;
+  if (t2Ms < t1Ms)
+    t2Ms = t1Ms;
+  if (t3Ms < t2Ms)
+    t3Ms = t2Ms;
+
+  lock();
+  _rampDelay = delayMs;
+  _rampT1 = t1Ms;
+  _rampT2 = t2Ms;
+  _rampT3 = t3Ms;
+  _rampR1 = rate1;
+  _rampR2 = rate2;
+  _rampR3 = rate3;
+  _rampR4 = rate4;
+
+  // Precalcular distancia al inicio de cada tramo => rampDistance() en O(1)
+  uint64_t c = 1;
+  c += (uint64_t)rate1 * (t1Ms - delayMs) / 1000u;
+  _rampC2 = (c > 0xFFFFFFFFu) ? 0xFFFFFFFFu : (uint32_t)c;
+  c += (uint64_t)rate2 * (t2Ms - t1Ms) / 1000u;
+  _rampC3 = (c > 0xFFFFFFFFu) ? 0xFFFFFFFFu : (uint32_t)c;
+  c += (uint64_t)rate3 * (t3Ms - t2Ms) / 1000u;
+  _rampC4 = (c > 0xFFFFFFFFu) ? 0xFFFFFFFFu : (uint32_t)c;
+  unlock();
+}
+
+uint32_t JWMatrixButtons::rampDistance(uint32_t heldMs) const
+{
+  uint64_t d;
+  if (heldMs < _rampDelay)
+    d = 1;
+  else if (heldMs < _rampT1)
+    d = 1 + (uint64_t)_rampR1 * (heldMs - _rampDelay) / 1000u;
+  else if (heldMs < _rampT2)
+    d = _rampC2 + (uint64_t)_rampR2 * (heldMs - _rampT1) / 1000u;
+  else if (heldMs < _rampT3)
+    d = _rampC3 + (uint64_t)_rampR3 * (heldMs - _rampT2) / 1000u;
+  else
+    d = _rampC4 + (uint64_t)_rampR4 * (heldMs - _rampT3) / 1000u;
+
+  return (d > 0xFFFFFFFFu) ? 0xFFFFFFFFu : (uint32_t)d;
+}
+
+void JWMatrixButtons::holdInfo_(uint8_t id, HoldInfo &h) const
+{
+  lock();
+  h.down = (_btnPrev >> id) & 1u; // estado ya procesado en el último update()
+  h.seq = _btnT[id].pressSeq;
+  h.start = _btnT[id].pressStart;
+  h.last = _btnT[id].lastHeld;
+  h.held = h.down ? (millis() - h.start) : h.last;
+  unlock();
+}
+
+bool JWMatrixButtons::applyRamp(uint32_t &val, uint32_t minv, uint32_t maxv,
+                                uint8_t decId, uint8_t incId, RampState &st) const
+{
+  if (minv > maxv)
+    return false;
+  if (decId >= _btnCount || incId >= _btnCount)
+    return false;
+
+  HoldInfo dec, inc;
+  holdInfo_(decId, dec);
+  holdInfo_(incId, inc);
+
+  if (!st.init)
+  {
+    st.origin = val;
+    st.active = NO_ID;
+    st.seqDec = dec.seq;
+    st.seqInc = inc.seq;
+    st.init = true;
+    return false;
+  }
+
+  uint32_t v = val;
+
+  // origen ± distancia, saturado al rango
+  auto target = [&](bool isInc, uint32_t origin, uint32_t dist) -> uint32_t {
+    if (origin < minv)
+      origin = minv;
+    if (origin > maxv)
+      origin = maxv;
+    if (isInc)
+      return (dist >= maxv - origin) ? maxv : origin + dist;
+    return (dist >= origin - minv) ? minv : origin - dist;
+  };
+
+  // Un botón a la vez: un press nuevo (en cualquiera de los dos) toma el eje
+  bool decNew = (dec.seq != st.seqDec);
+  bool incNew = (inc.seq != st.seqInc);
+
+  // El mantenido en curso se cierra antes de tomar el press nuevo, con su
+  // duración real (no la del frame anterior), así el resultado no depende del
+  // ritmo del loop:
+  // - terminó y volvió a empezar entre dos frames: su duración final (lastHeld)
+  // - sigue presionado y el otro botón toma el eje: hasta el press del otro
+  if ((decNew || incNew) && (st.active == decId || st.active == incId))
+  {
+    bool isInc = (st.active == incId);
+    const HoldInfo &a = isInc ? inc : dec;
+    const HoldInfo &o = isInc ? dec : inc;
+    uint32_t held;
+    if (isInc ? incNew : decNew)
+      held = a.last;
+    else if (a.down)
+      held = o.start - a.start;
+    else
+      held = a.held;
+    v = target(isInc, st.origin, rampDistance(held));
+    st.active = NO_ID;
+  }
+
+  for (uint8_t k = 0; k < 2; k++)
+  {
+    bool isInc = (k == 1);
+    bool isNew = isInc ? incNew : decNew;
+    if (!isNew)
+      continue;
+
+    uint8_t seq = isInc ? inc.seq : dec.seq;
+    uint8_t &seen = isInc ? st.seqInc : st.seqDec;
+
+    // Pulsaciones completas que pasaron entre dos frames: un toque = ±1 cada una
+    uint8_t missed = (uint8_t)(seq - seen - 1);
+    v = target(isInc, v, missed);
+
+    seen = seq;
+    st.active = isInc ? incId : decId;
+    st.origin = v;
+  }
+
+  if (st.active == decId || st.active == incId)
+  {
+    bool isInc = (st.active == incId);
+    const HoldInfo &a = isInc ? inc : dec;
+    v = target(isInc, st.origin, rampDistance(a.held));
+
+    // Soltado: el valor queda fijo con la duración final
+    if (!a.down)
+      st.active = NO_ID;
+  }
+
+  bool changed = (v != val);
+  val = v;
+  return changed;
+}
+#endif
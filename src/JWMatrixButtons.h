@@ -1,13 +1,18 @@
 #pragma once
-#include <Arduino.h>
+#include "JWMatrixButtonsConfig.h"
+#include "JWMatrixBackend.h"
 
 // Opcional: soporte de task en ESP32 (FreeRTOS)
-#if defined(ARDUINO_ARCH_ESP32)
+#if JWMB_HAS_RTOS
   #include "freertos/FreeRTOS.h"
   #include "freertos/task.h"
   #include "freertos/semphr.h"
 #endif
 
+// Ver JWMB_FLAGS_NS en JWMatrixButtonsConfig.h
+inline namespace JWMB_FLAGS_NS
+{
+
 class JWMatrixButtons
 {
 public:
@@ -15,15 +20,16 @@ public:
   {
     EV_PRESS = 1,
     EV_RELEASE = 2,
-    EV_REPEAT = 3
+    EV_REPEAT = 3,
+    EV_DETENT = 4 // encoder: un detent (id = decId/incId)
   };
 
   struct BtnEvent
   {
     uint8_t id;
     EvType type;
-    int16_t mult;     // para repeat: 1/10/100/1000 (o lo que configures)
-    uint32_t held_ms; // tiempo sostenido
+    int16_t mult;     // para repeat/detent: 1/10/100/1000 (o lo que configures)
+    uint32_t held_ms; // tiempo sostenido (detent: ms desde el detent anterior)
   };
 
   struct BtnMapItem
@@ -33,6 +39,25 @@ public:
     uint8_t col;
   };
 
+#if JWMB_ENABLE_DIAGNOSTICS
+  // Histograma de duración de rebote (primer a último flanco raw de un cambio):
+  // bins = 0 (limpio), <=1, <=2, <=5, <=10, <=20, <=50, >50 ms
+  static const uint8_t HEALTH_BINS = 8;
+
+  struct KeyHealth
+  {
+    uint16_t presses;     // pulsaciones estables
+    uint32_t pressEdges;  // flancos raw en cambios que terminaron en press (ideal: 1 por press)
+    uint8_t maxEdges;     // máximo de flancos raw en un solo cambio
+    uint8_t stuckEvents;  // veces que se sostuvo más de stuckMs
+    uint16_t unsettled;   // cambios que no se asentaron en unsettledMs
+    uint16_t bounceHist[HEALTH_BINS];
+    bool stuck;           // ahora mismo sostenida más de stuckMs
+    bool settling;        // ahora mismo rebotando sin asentarse
+    uint32_t heldMs;      // tiempo sostenida actual (0 si suelta)
+  };
+#endif
+
   JWMatrixButtons();
 
   // =========================
@@ -45,8 +70,22 @@ public:
              bool invertLogic = false,
              uint32_t debounceMs = 35);
 
+  // Para backends con topología propia (JWMatrixDirect, JWMatrixCharlieplex):
+  // filas/columnas virtuales y delays de escaneo los da el backend. Con pull-ups
+  // (lo normal en estos backends) la tecla activa es LOW => invertLogic=true.
+  bool begin(const BtnMapItem *map, uint8_t mapLen,
+             uint8_t buttonCount,
+             bool invertLogic = true,
+             uint32_t debounceMs = 35);
+
+  // Backend de escaneo (ver JWMatrixBackend.h). Llamar antes de begin().
+  // En Arduino el default es GPIO directo; fuera de Arduino es obligatorio
+  // (ej. JWMatrixLinuxGpio).
+  void setBackend(JWMatrixBackend *backend);
+
   // Ajustes finos (opcionales)
   void setScanDelays(uint16_t settleUs, uint16_t betweenRowsUs);
+#if JWMB_ENABLE_REPEAT
   void setRepeatEnabled(uint8_t id, bool enabled);
   void setRepeatInitialDelay(uint32_t ms);
 
@@ -54,14 +93,137 @@ public:
   void setRepeatProfile(uint16_t thr1, uint16_t thr2, uint16_t thr3,
                         int16_t s1, int16_t s2, int16_t s3, int16_t s4,
                         uint32_t d1, uint32_t d2, uint32_t d3, uint32_t d4);
+#endif
 
   // Llamar en loop, ideal cada 3–10 ms (si NO usas task)
   void update();
 
+  // Espera en reposo: si no hay teclas presionadas ni rebotando, activa todas
+  // las filas y bloquea en el backend hasta un flanco o timeout. Si hay
+  // actividad (o el backend no sabe esperar) vuelve al instante.
+  // true = hay que escanear ya. No usar junto con startTask().
+  bool waitForActivity(uint32_t timeoutMs);
+
+  // =========================
+  // Mapas / capas en caliente
+  // =========================
+  // Cambian el mapa sin parar el escaneo ni resetear estados (a diferencia de begin()):
+  // - el mapa se compila a un plan de escaneo (ver begin()) y se aplica entre
+  //   dos frames de update()
+  // - una tecla sostenida conserva el id con el que se presionó hasta que se suelta,
+  //   así que no hay PRESS/RELEASE espurios al cambiar
+  // - llamar desde un solo task (el del UI), después de begin()
+  static const uint8_t MAX_LAYERS = 4;
+
+  bool setMap(const BtnMapItem *map, uint8_t mapLen);
+
+  // Capas: registra hasta MAX_LAYERS mapas y cambia entre ellos con setLayer().
+  // begin() registra su mapa como capa 0.
+  bool setLayerMap(uint8_t layer, const BtnMapItem *map, uint8_t mapLen);
+  bool setLayer(uint8_t layer);
+  uint8_t layer() const;
+
+#if JWMB_ENABLE_SCAN_GROUPS
+  // =========================
+  // Grupos de escaneo
+  // =========================
+  // Cada posición pertenece a un grupo con su propio periodo y debounce; en cada
+  // update() solo se escanean (settle incluido) las filas/columnas de los grupos
+  // que tocan. Ej.: fila de navegación/jog a 1 ms, configuración a 20 ms.
+  // - Grupo 0 = default de todas las filas. periodMs = 0: en cada update().
+  // - setKeyGroup() (por id, vía el mapa) tiene prioridad sobre setRowGroup().
+  // - update() tiene que llamarse al menos tan seguido como el grupo más rápido;
+  //   el task de ESP32 ya duerme el periodo más corto entre grupos y taskPeriod.
+  // - Si un grupo usa periodo, dale uno también al grupo 0 (si no, el 0 se
+  //   escanea en cada update() del ritmo rápido).
+  // - Configurar después de begin() (begin() los resetea). Se aplican entre
+  //   frames, como setMap().
+  static const uint8_t MAX_SCAN_GROUPS = 4;
+  static const uint8_t GROUP_OF_ROW = 0xFF; // setKeyGroup(): volver al de su fila
+
+  bool setScanGroup(uint8_t group, uint16_t periodMs, uint32_t debounceMs);
+  bool setRowGroup(uint8_t row, uint8_t group);
+  bool setKeyGroup(uint8_t id, uint8_t group);
+#endif
+
+#if JWMB_ENABLE_DIAGNOSTICS
+  // =========================
+  // Diagnóstico por tecla
+  // =========================
+  // Se recolecta en el debounce de cada posición escaneada. Sirve para ver qué
+  // switches rebotan/chatean o están pegados antes de subir debounceMs global.
+  // - stuckMs: sostenida más que esto => stuck (por defecto 30000)
+  // - unsettledMs: rebotando más que esto sin asentarse => unsettled (por defecto 500)
+  void setHealthThresholds(uint32_t stuckMs, uint32_t unsettledMs);
+  bool getKeyHealth(uint8_t row, uint8_t col, KeyHealth &out) const;
+  bool getButtonHealth(uint8_t id, KeyHealth &out) const; // por id en el mapa activo
+  void resetHealth();
+#endif
+
+#if JWMB_ENABLE_ENCODER
+  // =========================
+  // Encoders rotativos
+  // =========================
+  // - Cada encoder usa 2 ids "virtuales" (decId/incId, < buttonCount, normalmente
+  //   fuera del mapa). Por update() y sentido genera un EV_DETENT con
+  //   mult = paso × detents (paso según la velocidad de giro, como el perfil de
+  //   repeat pero por detents/s; satura en 32767) y held_ms = intervalo medio.
+  // - applyAxis() consume los detents junto con las teclas, como pasos de repeat
+  //   (snap y saturan en los topes). Sin JWMB_ENABLE_REPEAT cuentan como press (±1).
+  //   Se acumulan por encoder hasta applyAxis(): no pasan por la cola de repeats.
+  // - Decodificación por tabla full-step (1 detent = ciclo completo, reposo en
+  //   A=B=1 con pull-ups): los rebotes de contacto no generan detents.
+  // - Polling: en cada update() (y cada 1 ms dentro del task). Para giros rápidos
+  //   sin task usar useInterrupt (solo ESP32: attachInterruptArg en A y B).
+  // - Con pinA = ENC_NO_PIN (o fuera de Arduino) no se leen pines: alimentar con
+  //   encoderInput() desde tu propia ISR/driver.
+  // - Configurar después de begin(); begin() no los borra (clearEncoders()).
+  // - Si gira al revés: intercambiar pinA/pinB (o decId/incId).
+  static const uint8_t MAX_ENCODERS = 2;
+  static const uint8_t ENC_NO_PIN = 0xFF;
+
+  bool addEncoder(uint8_t pinA, uint8_t pinB, uint8_t decId, uint8_t incId,
+                  bool useInterrupt = false);
+  void clearEncoders();
+
+  // Umbrales en detents/s y pasos (por defecto 10/25/50 y 1/10/100/1000)
+  void setEncoderProfile(uint16_t rate1, uint16_t rate2, uint16_t rate3,
+                         int16_t s1, int16_t s2, int16_t s3, int16_t s4);
+
+  // Niveles A/B del encoder ch (orden de alta). Seguro desde una ISR.
+  void encoderInput(uint8_t ch, bool a, bool b);
+#endif
+
+#if JWMB_ENABLE_PRIORITY
+  // =========================
+  // Teclas prioritarias (stop, feed-hold, ...)
+  // =========================
+  // - Debounce "eager": el primer flanco se reporta al instante y luego se ignoran
+  //   cambios durante debounceMs (no espera la ventana completa).
+  // - Se reportan por callback, antes y aparte de la cola normal (los
+  //   PRESS/RELEASE normales siguen llegando igual, con su debounce).
+  // - updatePriority() muestrea SOLO las filas con teclas prioritarias. El task
+  //   de ESP32 la llama cada 1 ms entre update(); sin task, llámala tan seguido
+  //   como puedas.
+  // - El callback corre en el contexto de update()/updatePriority() (el task si
+  //   está activo), fuera del lock: puede llamar a la API de la librería.
+  // - Configurar después de begin() (begin() las resetea).
+  typedef void (*PriorityCallback)(uint8_t id, EvType type, void *ctx);
+
+  bool setPriorityKey(uint8_t id, bool enabled);
+  void setPriorityCallback(PriorityCallback cb, void *ctx = nullptr);
+  void updatePriority();
+
+  // Latencia medida muestreo->despacho (incluye settle de la fila), en us
+  uint32_t priorityLatencyMaxUs() const;
+  void resetPriorityLatency();
+#endif
+
   // =========================
   // ESP32: correr update() en un task (otro núcleo si quieres)
   // =========================
-  // - En otros micros (sin FreeRTOS) estas funciones devuelven false / no hacen nada.
+  // - En otros micros (sin FreeRTOS) o con JWMB_ENABLE_THREAD_SAFE=0 estas
+  //   funciones devuelven false / no hacen nada.
   // - Si el task está activo, NO necesitas llamar update() en loop.
   bool startTask(uint8_t core = 1,
                  uint32_t stackBytes = 4096,
@@ -75,18 +237,23 @@ public:
   // =========================
   // Eventos
   // =========================
+#if JWMB_ENABLE_EVENT_LOG
   // Eventos generados en el último update() (útil para debug/log)
   uint8_t eventCount() const;
   bool getEvent(uint8_t index, BtnEvent &out) const;
+#endif
 
   // Helpers de estado
   // NOTA: pressed()/released() son "latcheados":
   // - si ocurre un PRESS/RELEASE, queda pendiente hasta que lo leas.
   // - esto ayuda muchísimo si update() corre en un task o tu loop a veces tarda.
   bool isDown(uint8_t id) const;
+#if JWMB_ENABLE_LATCHES
   bool pressed(uint8_t id) const;  // consume 1 PRESS pendiente
   bool released(uint8_t id) const; // consume 1 RELEASE pendiente
+#endif
 
+#if JWMB_ENABLE_AXIS
   // Helper genérico de “eje”
   // - circularWrapOnPress: si estás en max y haces INC (PRESS) => salta a min (y viceversa)
   // - snapToStepOnRepeat: antes de sumar/restar en REPEAT, alinea val al múltiplo del step
@@ -104,20 +271,101 @@ public:
     return applyAxis(&val, minv, maxv, decId, incId, circularWrapOnPress, snapToStepOnRepeat);
   }
 
+  // Rampa por mantenido (alternativa a applyAxis para rangos grandes)
+  // - El valor sale directo del tiempo sostenido: val = origen ± rampDistance(held),
+  //   en O(1) por frame. No usa EV_REPEAT ni la cola de repeats, así que da lo
+  //   mismo a cualquier ritmo de loop (no hace falta setRepeatEnabled()).
+  // - Un toque corto = ±1. Sin wrap: satura en minv/maxv.
+  // - Si un mantenido termina y empieza otro entre dos llamadas, el primero se
+  //   cierra con su duración final. Exacto mientras haya a lo sumo un press
+  //   nuevo por botón entre llamadas; los presses intermedios cuentan ±1.
+  // - RampState lo guarda el sketch (uno por eje); inicializar con {}.
+  struct RampState
+  {
+    uint32_t origin; // valor al empezar el mantenido actual
+    uint8_t active;  // id en curso (0xFF = ninguno)
+    uint8_t seqDec;  // últimas pulsaciones vistas de dec/inc
+    uint8_t seqInc;
+    bool init;
+  };
+
+  // Curva: tras delayMs, rate1 unidades/s hasta t1Ms de mantenido, rate2 hasta
+  // t2Ms, rate3 hasta t3Ms y rate4 desde ahí (t* medidos desde el press)
+  void setRampProfile(uint32_t delayMs,
+                      uint32_t rate1, uint32_t t1Ms,
+                      uint32_t rate2, uint32_t t2Ms,
+                      uint32_t rate3, uint32_t t3Ms,
+                      uint32_t rate4);
+
+  // Distancia recorrida tras heldMs de mantenido (1 en el press)
+  uint32_t rampDistance(uint32_t heldMs) const;
+
+  bool applyRamp(uint32_t &val, uint32_t minv, uint32_t maxv,
+                 uint8_t decId, uint8_t incId, RampState &st) const;
+#endif
+
 private:
   static const uint8_t MAX_ROWS = 8;
   static const uint8_t MAX_COLS = 8;
   static const uint8_t MAX_BTNS = 32;
   static const uint8_t MAX_EVENTS = 40;
   static const uint8_t REPEAT_Q = 8; // cola por botón para repeats
+  static const uint8_t PRIO_Q = 4;   // flancos prioritarios por pasada
+
+  static const uint8_t NO_ID = 0xFF;    // posición sin tecla sostenida
+  static const uint8_t UNMAPPED = 0xFE; // sostenida, pero sin id en el mapa
 
   struct DebouncedKey
   {
     bool stable;
     bool lastRaw;
     uint32_t lastChange;
+#if JWMB_ENABLE_DIAGNOSTICS
+    uint32_t bounceStart; // primer flanco del cambio en curso
+    uint8_t bounceEdges;  // flancos del cambio en curso (0 = asentada)
+    uint8_t diagFlags;    // DIAG_*
+    KeyHealth health;
+#endif
+  };
+
+#if JWMB_ENABLE_DIAGNOSTICS
+  static const uint8_t DIAG_UNSETTLED = 0x01; // ya contada como unsettled
+  static const uint8_t DIAG_STUCK = 0x02;     // ya contada como stuck
+#endif
+
+  // Plan de escaneo compilado desde el mapa (una vez, en begin()/setMap()):
+  // - colMask[r]: columnas con tecla en la fila r (0 = fila sin teclas, no se escanea)
+  // - id[r][c]: lookup (row,col)->id, NO_ID si la posición no está poblada
+  // - prioMask[r]: columnas de la fila r con tecla prioritaria
+  // - grpMask[g][r]: columnas de la fila r en el grupo g; grpUsed = grupos con teclas
+  struct ScanPlan
+  {
+    uint8_t colMask[MAX_ROWS];
+    uint8_t id[MAX_ROWS][MAX_COLS];
+#if JWMB_ENABLE_PRIORITY
+    uint8_t prioMask[MAX_ROWS];
+#endif
+#if JWMB_ENABLE_SCAN_GROUPS
+    uint8_t grpMask[MAX_SCAN_GROUPS][MAX_ROWS];
+    uint8_t grpUsed;
+#endif
   };
 
+#if JWMB_ENABLE_SCAN_GROUPS
+  struct ScanGroup
+  {
+    uint32_t next;       // próximo escaneo (millis)
+    uint32_t debounceMs; // grupo 0: usa _debounceMs
+    uint16_t periodMs;   // 0 = en cada update()
+  };
+#endif
+
+  // Backend
+  JWMatrixBackend *_backend;
+#if defined(ARDUINO)
+  JWMatrixGpioBackend _gpio;
+#endif
+
   // Config
   const uint8_t *_rowPins;
   const uint8_t *_colPins;
@@ -128,47 +376,148 @@ private:
   uint8_t _mapLen;
   uint8_t _btnCount;
 
+  // Plan de escaneo, doble buffer: se arma el inactivo y se conmuta bajo lock
+  // entre frames
+  ScanPlan _plan[2];
+  uint8_t _planActive;
+
+  // id con el que se presionó cada posición (NO_ID si está suelta).
+  // _heldMask mantiene en el escaneo las posiciones sostenidas aunque el mapa
+  // nuevo ya no las use, hasta que se sueltan.
+  uint8_t _heldId[MAX_ROWS][MAX_COLS];
+  uint8_t _heldMask[MAX_ROWS];
+
+  // Capas registradas
+  const BtnMapItem *_layerMap[MAX_LAYERS];
+  uint8_t _layerLen[MAX_LAYERS];
+  uint8_t _layer;
+
   bool _invert;
   uint32_t _debounceMs;
 
+#if JWMB_ENABLE_SCAN_GROUPS
+  // Grupos: config + scheduler. Asignación por fila y por id (GROUP_OF_ROW =
+  // hereda la de su fila); se compila al plan en compileMap_().
+  ScanGroup _grp[MAX_SCAN_GROUPS];
+  uint8_t _rowGroup[MAX_ROWS];
+  uint8_t _keyGroup[MAX_BTNS];
+  uint8_t _wakeGrp; // grupos por escanear tras un aviso de actividad en reposo
+#endif
+
+#if JWMB_ENABLE_DIAGNOSTICS
+  uint32_t _stuckMs;
+  uint32_t _unsettledMs;
+#endif
+
   // Scan delays
   uint16_t _settleUs;
   uint16_t _betweenRowsUs;
 
-  // Raw + debounced keys
+  // Raw (bitmask de columnas por fila) + debounced keys
   DebouncedKey _keyDeb[MAX_ROWS][MAX_COLS];
-  bool _raw[MAX_ROWS][MAX_COLS];
-  bool _deb[MAX_ROWS][MAX_COLS];
+  uint8_t _raw[MAX_ROWS];
 
-  // Buttons state
-  bool _btnStable[MAX_BTNS];
-  bool _btnPrev[MAX_BTNS];
-  uint32_t _btnPressStart[MAX_BTNS];
+  // Buttons state (hot): bit por id. emitEdgesAndRepeats() solo visita los bits
+  // de (cambiados | con repeat activo), el resto del tick no toca la parte fría.
+  uint32_t _btnStable;
+  uint32_t _btnPrev;
+#if JWMB_ENABLE_REPEAT
+  uint32_t _repeatMask;
+#endif
 
-  // Repeat config/state
-  bool _repeatEnabled[MAX_BTNS];
+  // Tiempos por botón (cold): solo se tocan en flancos y repeats
+  struct BtnTiming
+  {
+    uint32_t pressStart;
+#if JWMB_ENABLE_AXIS
+    uint32_t lastHeld; // rampa: duración del último mantenido
+#endif
+#if JWMB_ENABLE_REPEAT
+    uint32_t nextRepeatAt;
+    uint16_t repeatCount;
+#endif
+#if JWMB_ENABLE_AXIS
+    uint8_t pressSeq; // rampa: nº de press (módulo 256)
+#endif
+  };
+  BtnTiming _btnT[MAX_BTNS];
+
+#if JWMB_ENABLE_AXIS
+  // Curva de rampa; _rampC* = distancia acumulada al inicio de cada tramo
+  uint32_t _rampDelay;
+  uint32_t _rampT1, _rampT2, _rampT3;
+  uint32_t _rampR1, _rampR2, _rampR3, _rampR4;
+  uint32_t _rampC2, _rampC3, _rampC4;
+#endif
+
+#if JWMB_ENABLE_REPEAT
+  // Repeat config
   uint32_t _repeatInitialDelay;
 
   uint16_t _thr1, _thr2, _thr3;
   int16_t _s1, _s2, _s3, _s4;
   uint32_t _d1, _d2, _d3, _d4;
+#endif
 
-  uint32_t _nextRepeatAt[MAX_BTNS];
-  uint16_t _repeatCount[MAX_BTNS];
-
+#if JWMB_ENABLE_EVENT_LOG
   // Eventos del último update
   BtnEvent _events[MAX_EVENTS];
   uint8_t _evN;
+#endif
 
+#if JWMB_ENABLE_LATCHES
   // Latches (persisten hasta que los consumas)
   mutable uint8_t _pressPend[MAX_BTNS];
   mutable uint8_t _releasePend[MAX_BTNS];
+#if JWMB_ENABLE_REPEAT
   mutable int16_t _repQ[MAX_BTNS][REPEAT_Q];
   mutable uint8_t _repHead[MAX_BTNS];
   mutable uint8_t _repTail[MAX_BTNS];
   mutable uint8_t _repCountPend[MAX_BTNS];
+#endif
+#endif
 
-#if defined(ARDUINO_ARCH_ESP32)
+#if JWMB_ENABLE_PRIORITY
+  // Teclas prioritarias (bit por id) + estado del debounce eager
+  uint32_t _prioIds;
+  uint32_t _prioState;
+  uint32_t _prioEdgeAt[MAX_BTNS];
+  PriorityCallback _prioCb;
+  void *_prioCtx;
+  volatile uint32_t _prioLatMaxUs;
+#endif
+
+#if JWMB_ENABLE_ENCODER
+  // Encoder: el decoder (poll/ISR/encoderInput) solo escribe state/cw/ccw;
+  // update() compara contra seen* bajo lock, así la ISR no toma el mutex.
+  struct EncoderCh
+  {
+    uint8_t pinA, pinB;
+    uint8_t decId, incId;
+    bool isr;
+    volatile uint8_t state;      // estado de la tabla full-step
+    volatile uint16_t cw, ccw;   // detents decodificados (contadores libres)
+    uint16_t seenCw, seenCcw;    // ya emitidos
+    int8_t lastDir;              // +1 inc, -1 dec, 0 ninguno
+    uint16_t intervalMs;         // intervalo entre detents, suavizado
+    uint32_t lastAt;             // último detent emitido
+#if JWMB_ENABLE_AXIS
+    // Pendiente para applyAxis() por sentido ([0] dec, [1] inc). Los detents se
+    // acumulan aquí (no en la cola de repeats): un giro rápido no pierde pasos.
+    mutable uint16_t pendN[2];   // detents
+    mutable uint32_t pendAmt[2]; // suma de paso × detents
+    mutable int16_t pendStep[2]; // paso del último frame (para el snap)
+#endif
+  };
+
+  EncoderCh _enc[MAX_ENCODERS];
+  uint8_t _encN;
+  uint8_t _encPolled; // bit por encoder leído por polling
+  uint16_t _encR1, _encR2, _encR3;
+  int16_t _encS1, _encS2, _encS3, _encS4;
+#endif
+
+#if JWMB_HAS_RTOS
   // Sincronización + task
   mutable SemaphoreHandle_t _mtx;
   volatile bool _taskRun;
@@ -179,28 +528,85 @@ private:
 
   inline void lock() const
   {
-#if defined(ARDUINO_ARCH_ESP32)
+#if JWMB_HAS_RTOS
     if (_mtx)
       xSemaphoreTake(_mtx, portMAX_DELAY);
 #endif
   }
   inline void unlock() const
   {
-#if defined(ARDUINO_ARCH_ESP32)
+#if JWMB_HAS_RTOS
     if (_mtx)
       xSemaphoreGive(_mtx);
 #endif
   }
 
   void resetStates();
-  bool readCol(uint8_t pin) const;
-  void scanRaw(bool raw[MAX_ROWS][MAX_COLS]);
-  void debounceUpdate(DebouncedKey &k, bool rawNow);
+  void compileMap_(ScanPlan &dst, const BtnMapItem *map, uint8_t mapLen) const;
+  inline uint8_t scanCols_(uint8_t r) const
+  {
+    return (uint8_t)(_plan[_planActive].colMask[r] | _heldMask[r]);
+  }
+  inline uint8_t readCols_(uint8_t colMask)
+  {
+    uint8_t lv = _backend->readCols(colMask);
+    return (uint8_t)((_invert ? (uint8_t)~lv : lv) & colMask);
+  }
+  bool idle_() const;
+#if JWMB_ENABLE_SCAN_GROUPS
+  uint8_t dueGroups_(uint32_t now);
+  uint8_t groupCols_(uint8_t g, uint8_t r) const;
+  uint16_t schedTickMs_() const;
+#endif
+  void scanRaw(uint8_t raw[MAX_ROWS], const uint8_t cols[MAX_ROWS]);
+  void debounceUpdate(DebouncedKey &k, bool rawNow, uint32_t debounceMs);
+#if JWMB_ENABLE_DIAGNOSTICS
+  void healthUpdate_(DebouncedKey &k, bool edge, bool settled, bool wasStable, uint32_t now);
+  void resetHealth_(DebouncedKey &k);
+#endif
   void mapButtons();
   void pushEvent(uint8_t id, EvType type, int16_t mult, uint32_t held);
   void emitEdgesAndRepeats();
 
+#if JWMB_ENABLE_ENCODER
+  static void encStep_(EncoderCh &e, uint8_t ab);
+  void pollEncoders_();
+  void emitEncoders_(uint32_t now);
+#if JWMB_ENABLE_AXIS
+  void takeDetents_(uint8_t id, bool isInc, uint16_t &n, uint32_t &amt, int16_t &step) const;
+#endif
+#if defined(ARDUINO_ARCH_ESP32)
+  static void encIsr_(void *arg);
+#endif
+#endif
+
+#if JWMB_ENABLE_AXIS
+  // Foto del mantenido de un id para applyRamp()
+  struct HoldInfo
+  {
+    bool down;
+    uint8_t seq;    // pressSeq
+    uint32_t start; // millis() del último press
+    uint32_t held;  // en curso si down, si no la duración final
+    uint32_t last;  // duración final del último mantenido terminado
+  };
+  void holdInfo_(uint8_t id, HoldInfo &h) const;
+#endif
+
+#if JWMB_ENABLE_PRIORITY
+  uint8_t prioCols_(uint8_t r) const;
+  uint32_t prioGather_(const uint8_t raw[MAX_ROWS]) const;
+  uint8_t prioEval_(uint32_t rawIds, BtnEvent out[PRIO_Q]);
+  void prioDispatch_(const BtnEvent ev[], uint8_t n, uint32_t t0Us);
+#endif
+
+#if JWMB_ENABLE_LATCHES
   void latchEvent_(const BtnEvent &e);
+#if JWMB_ENABLE_REPEAT
   void repQPush_(uint8_t id, int16_t mult) const;
   bool repQPop_(uint8_t id, int16_t &mult) const;
+#endif
+#endif
 };
+
+} // inline namespace JWMB_FLAGS_NS
@@ -0,0 +1,107 @@
+#pragma once
+
+// =========================
+// Selección de features en compilación
+// =========================
+// Cada flag vale 1 (incluido) o 0 (eliminado). Con 0 se quita tanto el código
+// como el estado (RAM) de esa feature, y su API deja de existir.
+//
+// Se pueden definir desde el build (ej. PlatformIO):
+//   build_flags = -DJWMB_ENABLE_REPEAT=0 -DJWMB_ENABLE_EVENT_LOG=0
+// o editando los valores por defecto de este archivo.
+//
+// Ver README ("Build mínimo") para el ahorro de RAM/flash de cada flag.
+
+// Repeat por mantenido: setRepeat*(), EV_REPEAT y su cola por botón.
+#ifndef JWMB_ENABLE_REPEAT
+  #define JWMB_ENABLE_REPEAT 1
+#endif
+
+// Latches: pressed()/released() (y la cola de repeats para applyAxis).
+#ifndef JWMB_ENABLE_LATCHES
+  #define JWMB_ENABLE_LATCHES 1
+#endif
+
+// Log de eventos del último update(): eventCount()/getEvent().
+#ifndef JWMB_ENABLE_EVENT_LOG
+  #define JWMB_ENABLE_EVENT_LOG 1
+#endif
+
+// Helper de eje: applyAxis(). Requiere latches.
+#ifndef JWMB_ENABLE_AXIS
+  #define JWMB_ENABLE_AXIS 1
+#endif
+
+// ESP32: mutex FreeRTOS + startTask(). Sin esto la instancia es de un solo hilo
+// y startTask() devuelve false (igual que en micros sin FreeRTOS).
+#ifndef JWMB_ENABLE_THREAD_SAFE
+  #define JWMB_ENABLE_THREAD_SAFE 1
+#endif
+
+// Teclas prioritarias: setPriorityKey(), callback inmediato y updatePriority().
+#ifndef JWMB_ENABLE_PRIORITY
+  #define JWMB_ENABLE_PRIORITY 1
+#endif
+
+// Grupos de escaneo: setScanGroup()/setRowGroup()/setKeyGroup(), cada uno con
+// su periodo y debounce.
+#ifndef JWMB_ENABLE_SCAN_GROUPS
+  #define JWMB_ENABLE_SCAN_GROUPS 1
+#endif
+
+// Encoders rotativos: addEncoder(), EV_DETENT con aceleración por velocidad.
+#ifndef JWMB_ENABLE_ENCODER
+  #define JWMB_ENABLE_ENCODER 1
+#endif
+
+// Diagnóstico por tecla (rebotes, histograma, teclas pegadas). Opcional: cuesta
+// ~44 B de RAM por posición de la matriz (~2.8 KB en total).
+#ifndef JWMB_ENABLE_DIAGNOSTICS
+  #define JWMB_ENABLE_DIAGNOSTICS 0
+#endif
+
+// Backend de expansor (JWMatrixExpander, solo Arduino). Por defecto 0: así
+// <Wire.h>/<SPI.h> no entran en el build de quien no lo usa.
+// - JWMB_ENABLE_EXPANDER: MCP23017 / PCF8574 por I2C (Wire).
+// - JWMB_ENABLE_EXPANDER_SPI: además MCP23S17 por SPI. Requiere el anterior.
+#ifndef JWMB_ENABLE_EXPANDER
+  #define JWMB_ENABLE_EXPANDER 0
+#endif
+
+#ifndef JWMB_ENABLE_EXPANDER_SPI
+  #define JWMB_ENABLE_EXPANDER_SPI 0
+#endif
+
+#if JWMB_ENABLE_AXIS && !JWMB_ENABLE_LATCHES
+  #error "JWMB_ENABLE_AXIS requiere JWMB_ENABLE_LATCHES=1"
+#endif
+
+#if JWMB_ENABLE_EXPANDER_SPI && !JWMB_ENABLE_EXPANDER
+  #error "JWMB_ENABLE_EXPANDER_SPI requiere JWMB_ENABLE_EXPANDER=1"
+#endif
+
+// Uso interno: firma de los flags en el nombre de las clases.
+// Los flags cambian el layout de JWMatrixButtons (y el de JWMatrixExpander), y
+// el sketch y los .cpp de la librería se compilan por separado: si el sketch
+// ve otros valores (ej. un #define antes del #include en el IDE de Arduino,
+// que no llega a los .cpp de la librería), ambos no estarían de acuerdo en
+// sizeof() y se corrompería memoria sin aviso. Las clases viven en un inline
+// namespace con los valores de los flags en el nombre: con flags distintos el
+// link falla ("undefined reference to jwmb_flags_...::JWMatrixButtons::...").
+// El código de usuario no lo ve: JWMatrixButtons se sigue nombrando igual.
+#define JWMB_CAT_(a, b) a##b
+#define JWMB_CAT(a, b) JWMB_CAT_(a, b)
+#define JWMB_FLAGS_NS                                                         \
+  JWMB_CAT(JWMB_CAT(JWMB_CAT(JWMB_CAT(JWMB_CAT(JWMB_CAT(JWMB_CAT(JWMB_CAT(     \
+  JWMB_CAT(JWMB_CAT(JWMB_CAT(jwmb_flags_,                                      \
+  JWMB_ENABLE_REPEAT), JWMB_ENABLE_LATCHES), JWMB_ENABLE_EVENT_LOG),           \
+  JWMB_ENABLE_AXIS), JWMB_ENABLE_THREAD_SAFE), JWMB_ENABLE_PRIORITY),          \
+  JWMB_ENABLE_SCAN_GROUPS), JWMB_ENABLE_ENCODER), JWMB_ENABLE_DIAGNOSTICS),    \
+  JWMB_ENABLE_EXPANDER), JWMB_ENABLE_EXPANDER_SPI)
+
+// Uso interno: task/mutex solo existen en ESP32 y con thread safety activo
+#if defined(ARDUINO_ARCH_ESP32) && JWMB_ENABLE_THREAD_SAFE
+  #define JWMB_HAS_RTOS 1
+#else
+  #define JWMB_HAS_RTOS 0
+#endif
@@ -0,0 +1,315 @@
+#include "JWMatrixExpander.h"
+
+#if defined(ARDUINO) && JWMB_ENABLE_EXPANDER
+
+// MCP23017 / MCP23S17, IOCON.BANK = 0
+static const uint8_t MCP_IODIRA = 0x00;
+static const uint8_t MCP_IODIRB = 0x01;
+static const uint8_t MCP_GPINTENB = 0x05;
+static const uint8_t MCP_INTCONB = 0x09;
+static const uint8_t MCP_IOCON = 0x0A;
+static const uint8_t MCP_GPPUB = 0x0D;
+static const uint8_t MCP_GPIOA = 0x12;
+static const uint8_t MCP_GPIOB = 0x13;
+static const uint8_t MCP_IOCON_MIRROR = 0x40; // INTA/INTB unidos
+static const uint8_t MCP_IOCON_HAEN = 0x08;   // MCP23S17: usar A2..A0
+static const uint8_t MCP_SPI_OPCODE = 0x40;   // 0100 A2 A1 A0 R/W
+
+JWMatrixExpander::JWMatrixExpander(Chip chip, uint8_t i2cAddr, TwoWire &wire)
+    : _chip(chip), _addr(i2cAddr), _wire(&wire),
+#if JWMB_ENABLE_EXPANDER_SPI
+      _spi(nullptr), _csPin(0), _spiHz(0),
+#endif
+      _intPin(-1),
+      _nRows(0), _nCols(0), _rowMask(0), _colMask(0),
+      _want(ROW_NONE), _written(ROW_NONE), _settleUs(0), _pending(false), _xfers(0)
+{
+}
+
+#if JWMB_ENABLE_EXPANDER_SPI
+JWMatrixExpander::JWMatrixExpander(SPIClass &spi, uint8_t csPin, uint8_t hwAddr,
+                                   uint32_t spiHz)
+    : _chip(CHIP_MCP23S17), _addr((uint8_t)(hwAddr & 0x07)), _wire(nullptr),
+      _spi(&spi), _csPin(csPin), _spiHz(spiHz),
+      _intPin(-1),
+      _nRows(0), _nCols(0), _rowMask(0), _colMask(0),
+      _want(ROW_NONE), _written(ROW_NONE), _settleUs(0), _pending(false), _xfers(0)
+{
+}
+#endif
+
+void JWMatrixExpander::setIntPin(int8_t pin)
+{
+  _intPin = pin;
+}
+
+void JWMatrixExpander::setSettleUs(uint16_t settleUs)
+{
+  _settleUs = settleUs;
+}
+
+bool JWMatrixExpander::begin(const uint8_t *rowPins, uint8_t nRows,
+                             const uint8_t *colPins, uint8_t nCols)
+{
+  _nRows = nRows;
+  _nCols = nCols;
+  _rowMask = 0;
+  _colMask = 0;
+  for (uint8_t r = 0; r < nRows; r++)
+  {
+    if (rowPins[r] > 7)
+      return false;
+    _rowBit[r] = (uint8_t)(1u << rowPins[r]);
+    _rowMask |= _rowBit[r];
+  }
+  for (uint8_t c = 0; c < nCols; c++)
+  {
+    if (colPins[c] > 7)
+      return false;
+    _colBit[c] = (uint8_t)(1u << colPins[c]);
+    _colMask |= _colBit[c];
+  }
+  if (_chip == CHIP_PCF8574 && (_rowMask & _colMask))
+    return false;
+
+#if JWMB_ENABLE_EXPANDER_SPI
+  if (_chip == CHIP_MCP23S17)
+  {
+    pinMode(_csPin, OUTPUT);
+    digitalWrite(_csPin, HIGH);
+    _spi->begin();
+  }
+  else
+#endif
+  {
+    _wire->begin();
+  }
+  if (_intPin >= 0)
+    pinMode(_intPin, INPUT_PULLUP);
+
+  // Reposo: con INT, todas las filas activas (cualquier tecla dispara INT);
+  // sin INT, todas sueltas
+  uint8_t rest = (_intPin >= 0) ? ROW_ALL : ROW_NONE;
+
+  bool ok = true;
+  _written = (rest == ROW_NONE) ? ROW_ALL : ROW_NONE; // fuerza escribir el reposo
+  if (isMcp_())
+  {
+    uint8_t iocon = MCP_IOCON_MIRROR;
+    if (_chip == CHIP_MCP23S17)
+      iocon |= MCP_IOCON_HAEN;
+    if (_chip == CHIP_MCP23S17 && _addr != 0)
+    {
+      // Con HAEN=0 el chip responde solo a A2..A0 = 0: activar HAEN por ahí
+      uint8_t hw = _addr;
+      _addr = 0;
+      ok = writeReg_(MCP_IOCON, iocon);
+      _addr = hw;
+    }
+    ok = ok &&
+         writeReg_(MCP_IOCON, iocon) &&
+         writeReg_(MCP_IODIRA, (uint8_t)~_rowMask) &&
+         writeReg_(MCP_IODIRB, 0xFF) &&
+         writeReg_(MCP_GPPUB, _colMask) &&
+         writeReg_(MCP_INTCONB, 0x00) && // INT por cambio respecto al valor anterior
+         writeReg_(MCP_GPINTENB, (_intPin >= 0) ? _colMask : 0);
+  }
+  ok = ok && writeRow_(rest);
+  _want = rest;
+
+  // Leer las columnas una vez limpia cualquier INT pendiente
+  if (ok)
+    readCols(0xFF);
+  return ok;
+}
+
+uint8_t JWMatrixExpander::rowPort_(uint8_t row) const
+{
+  // Filas activas en LOW. En PCF8574 las columnas (y pines libres) quedan en 1
+  // para que funcionen como entradas.
+  uint8_t active = 0;
+  if (row == ROW_ALL)
+    active = _rowMask;
+  else if (row < _nRows)
+    active = _rowBit[row];
+
+  uint8_t port = (uint8_t)(_rowMask & ~active);
+  if (_chip == CHIP_PCF8574)
+    port |= (uint8_t)~_rowMask;
+  return port;
+}
+
+bool JWMatrixExpander::writeRow_(uint8_t row)
+{
+  if (row == _written)
+    return true;
+
+  bool ok;
+  if (isMcp_())
+  {
+    ok = writeReg_(MCP_GPIOA, rowPort_(row));
+  }
+  else
+  {
+    uint8_t v = rowPort_(row);
+    ok = xfer_(&v, 1, nullptr, 0);
+  }
+  _written = row;
+  return ok;
+}
+
+void JWMatrixExpander::selectRow(uint8_t row)
+{
+  // Sin settle, la fila se escribe junto con la siguiente lectura (misma
+  // transacción). Con settle, se escribe ya: el delay del núcleo tiene que
+  // caer entre la escritura y la lectura.
+  // ROW_NONE no se escribe: la fila que quede activa no afecta al escaneo y
+  // ahorra una transacción por fila.
+  _want = row;
+  if (_settleUs && row != ROW_NONE)
+    writeRow_(row);
+}
+
+uint8_t JWMatrixExpander::readCols(uint8_t colMask)
+{
+  uint8_t port = 0xFF;
+
+  if (isMcp_())
+  {
+    if (_want != _written)
+    {
+      // [GPIOA, filas] + repeated start + leer GPIOB: una transacción
+      // (MCP23S17: frame de escritura + frame de lectura)
+      uint8_t tx[2] = {MCP_GPIOA, rowPort_(_want)};
+      xfer_(tx, 2, &port, 1);
+      _written = _want;
+    }
+    else
+    {
+      uint8_t reg = MCP_GPIOB;
+      xfer_(&reg, 1, &port, 1);
+    }
+  }
+  else
+  {
+    writeRow_(_want);
+    xfer_(nullptr, 0, &port, 1);
+  }
+
+  // Leer el puerto limpia INT en el chip. Si una lectura parcial (solo algunas
+  // columnas, ej. updatePriority()) ve otra columna activa, esa tecla ya no
+  // vuelve a disparar INT: queda pendiente para activityPending().
+  if ((uint8_t)~port & _colMask)
+    _pending = true;
+
+  return portToCols_(port, colMask);
+}
+
+uint8_t JWMatrixExpander::portToCols_(uint8_t port, uint8_t colMask) const
+{
+  uint8_t bits = 0;
+  for (uint8_t c = 0; c < _nCols; c++)
+  {
+    if ((colMask & (1u << c)) && (port & _colBit[c]))
+      bits |= (uint8_t)(1u << c);
+  }
+  return bits;
+}
+
+bool JWMatrixExpander::activityPending()
+{
+  if (_intPin < 0)
+    return true;
+
+  // Armar el reposo: todas las filas activas para que cualquier tecla cambie
+  // una columna y dispare INT. Solo cuesta una transacción al entrar en reposo.
+  writeRow_(ROW_ALL);
+  bool pending = _pending;
+  _pending = false;
+  return pending || digitalRead(_intPin) == LOW;
+}
+
+bool JWMatrixExpander::waitColEdge(uint32_t timeoutMs)
+{
+  if (_intPin < 0)
+    return true;
+
+  // Esperar INT sin tocar el bus (las filas ya quedaron todas activas)
+  uint32_t t0 = millis();
+  while (digitalRead(_intPin) != LOW)
+  {
+    if ((millis() - t0) >= timeoutMs)
+      return false;
+    delay(1);
+  }
+  return true;
+}
+
+bool JWMatrixExpander::writeReg_(uint8_t reg, uint8_t val)
+{
+  uint8_t tx[2] = {reg, val};
+  return xfer_(tx, 2, nullptr, 0);
+}
+
+bool JWMatrixExpander::xfer_(const uint8_t *tx, uint8_t txN, uint8_t *rx, uint8_t rxN)
+{
+#if JWMB_ENABLE_EXPANDER_SPI
+  if (_chip == CHIP_MCP23S17)
+  {
+    // tx[0] = registro y el resto se escribe desde ahí (auto-incremento). La
+    // lectura sigue en el registro siguiente, como el puntero en I2C.
+    uint8_t reg = txN ? tx[0] : 0;
+    bool ok = true;
+    if (txN > 1)
+      ok = spiFrame_(false, reg, tx + 1, nullptr, (uint8_t)(txN - 1));
+    if (ok && rxN)
+      ok = spiFrame_(true, (uint8_t)(reg + (txN ? txN - 1 : 0)), nullptr, rx, rxN);
+    return ok;
+  }
+#endif
+
+  _xfers++;
+
+  if (txN)
+  {
+    _wire->beginTransmission(_addr);
+    for (uint8_t i = 0; i < txN; i++)
+      _wire->write(tx[i]);
+    // Con lectura a continuación: repeated start (sin STOP)
+    if (_wire->endTransmission(rxN == 0) != 0)
+      return false;
+  }
+
+  if (rxN)
+  {
+    if (_wire->requestFrom(_addr, rxN) != rxN)
+      return false;
+    for (uint8_t i = 0; i < rxN; i++)
+      rx[i] = (uint8_t)_wire->read();
+  }
+  return true;
+}
+
+#if JWMB_ENABLE_EXPANDER_SPI
+bool JWMatrixExpander::spiFrame_(bool read, uint8_t reg, const uint8_t *tx,
+                                 uint8_t *rx, uint8_t n)
+{
+  _xfers++;
+
+  _spi->beginTransaction(SPISettings(_spiHz, MSBFIRST, SPI_MODE0));
+  digitalWrite(_csPin, LOW);
+  _spi->transfer((uint8_t)(MCP_SPI_OPCODE | (_addr << 1) | (read ? 1 : 0)));
+  _spi->transfer(reg);
+  for (uint8_t i = 0; i < n; i++)
+  {
+    uint8_t v = _spi->transfer(tx ? tx[i] : 0);
+    if (rx)
+      rx[i] = v;
+  }
+  digitalWrite(_csPin, HIGH);
+  _spi->endTransaction();
+  return true;
+}
+#endif
+
+#endif
@@ -0,0 +1,118 @@
+#pragma once
+#include "JWMatrixButtonsConfig.h"
+#include "JWMatrixBackend.h"
+
+#if defined(ARDUINO) && JWMB_ENABLE_EXPANDER
+#include <Wire.h>
+#if JWMB_ENABLE_EXPANDER_SPI
+#include <SPI.h>
+#endif
+
+// =========================
+// Backend: matriz detrás de un expansor (MCP23017 / PCF8574 / MCP23S17)
+// =========================
+// Requiere JWMB_ENABLE_EXPANDER=1 (y JWMB_ENABLE_EXPANDER_SPI=1 para el
+// MCP23S17), ver JWMatrixButtonsConfig.h.
+//
+// - MCP23017: filas en el puerto A, columnas en el puerto B (rowPins/colPins
+//   son bits 0..7 de cada puerto). Por fila hay UNA transacción: escribir GPIOA
+//   deja el puntero en GPIOB y, con repeated start, se leen todas las columnas.
+// - MCP23S17 (SPI): mismos registros y pines que el MCP23017. SPI no permite
+//   leer dentro de un frame de escritura: por fila son dos frames cortos
+//   (write GPIOA, read GPIOB), a 10 MHz son ~5 µs en total.
+// - PCF8574: filas y columnas comparten el único puerto (bits 0..7). Por fila:
+//   un write (filas) + un read (columnas); no tiene registros.
+// - Filas activas en LOW y columnas con pull-up (internos en MCP23017/S17,
+//   cuasi-bidireccionales en PCF8574): usar invertLogic=true en begin().
+// - Settle: con setScanDelays(0, ...) la fila se escribe junto con la lectura
+//   (una transacción en MCP23017); el settle efectivo es el tiempo de bus
+//   entre escribir GPIOA y muestrear GPIOB (~25 µs a 400 kHz). Con settle > 0
+//   la fila se escribe ya en selectRow() para que el delay caiga después.
+// - setIntPin(): con la línea INT del expansor conectada, en reposo quedan
+//   todas las filas activas y update() no toca el bus mientras INT no marque
+//   actividad. Una lectura parcial del puerto (updatePriority(), grupos de
+//   escaneo) también limpia INT: si ve alguna columna activa, la actividad
+//   queda pendiente hasta el siguiente activityPending().
+// - Transferencias bloqueantes: Wire/SPI de Arduino no ofrecen E/S asíncrona.
+// Ver JWMB_FLAGS_NS en JWMatrixButtonsConfig.h (el layout depende de _SPI)
+inline namespace JWMB_FLAGS_NS
+{
+
+class JWMatrixExpander : public JWMatrixBackend
+{
+public:
+  enum Chip : uint8_t
+  {
+    CHIP_MCP23017 = 0,
+    CHIP_PCF8574 = 1,
+    CHIP_MCP23S17 = 2
+  };
+
+  // I2C: MCP23017 / PCF8574
+  JWMatrixExpander(Chip chip, uint8_t i2cAddr = 0x20, TwoWire &wire = Wire);
+
+#if JWMB_ENABLE_EXPANDER_SPI
+  // SPI: MCP23S17. hwAddr = pines A2..A0 (0..7), spiHz = reloj del bus.
+  JWMatrixExpander(SPIClass &spi, uint8_t csPin, uint8_t hwAddr = 0,
+                   uint32_t spiHz = 10000000);
+#endif
+
+  // Pin del micro conectado a INT (activo en LOW); -1 = sin INT. Antes de begin().
+  void setIntPin(int8_t pin);
+
+  bool begin(const uint8_t *rowPins, uint8_t nRows,
+             const uint8_t *colPins, uint8_t nCols) override;
+  void selectRow(uint8_t row) override;
+  uint8_t readCols(uint8_t colMask) override;
+  bool activityPending() override;
+  bool waitColEdge(uint32_t timeoutMs) override;
+  void setSettleUs(uint16_t settleUs) override;
+
+  // Transacciones de bus hechas (I2C, o frames SPI), para medir/benchmark
+  uint32_t transactions() const { return _xfers; }
+  void resetTransactions() { _xfers = 0; }
+
+protected:
+  // Una transacción: escribe tx y, si rxN > 0, lee rxN bytes con repeated
+  // start (PCF8574: el read va como transacción aparte; MCP23S17: un frame de
+  // escritura y otro de lectura desde el registro siguiente). Se puede
+  // sobreescribir para simular el expansor o usar otro bus.
+  virtual bool xfer_(const uint8_t *tx, uint8_t txN, uint8_t *rx, uint8_t rxN);
+
+private:
+  Chip _chip;
+  uint8_t _addr;
+  TwoWire *_wire;
+#if JWMB_ENABLE_EXPANDER_SPI
+  SPIClass *_spi;
+  uint8_t _csPin;
+  uint32_t _spiHz;
+#endif
+  int8_t _intPin;
+
+  uint8_t _rowBit[8]; // bit del puerto de cada fila
+  uint8_t _colBit[8]; // bit del puerto de cada columna
+  uint8_t _nRows;
+  uint8_t _nCols;
+  uint8_t _rowMask;
+  uint8_t _colMask;
+
+  uint8_t _want;    // fila pedida por selectRow()
+  uint8_t _written; // fila realmente escrita en el expansor
+  uint16_t _settleUs;
+  bool _pending;    // alguna lectura vio una columna activa (INT ya limpiado)
+  uint32_t _xfers;
+
+  bool isMcp_() const { return _chip != CHIP_PCF8574; }
+  uint8_t rowPort_(uint8_t row) const;
+  bool writeRow_(uint8_t row);
+  bool writeReg_(uint8_t reg, uint8_t val);
+  uint8_t portToCols_(uint8_t port, uint8_t colMask) const;
+#if JWMB_ENABLE_EXPANDER_SPI
+  bool spiFrame_(bool read, uint8_t reg, const uint8_t *tx, uint8_t *rx, uint8_t n);
+#endif
+};
+
+} // inline namespace JWMB_FLAGS_NS
+
+#endif
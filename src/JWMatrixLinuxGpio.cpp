@@ -0,0 +1,177 @@
+#include "JWMatrixLinuxGpio.h"
+
+#if defined(__linux__) && !defined(ARDUINO)
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <linux/gpio.h>
+
+JWMatrixLinuxGpio::JWMatrixLinuxGpio(const char *chipPath, bool rowActiveHigh)
+    : _chipPath(chipPath), _rowActiveHigh(rowActiveHigh),
+      _rowFd(-1), _colFd(-1), _epFd(-1), _nRows(0), _active(ROW_NONE)
+{
+}
+
+JWMatrixLinuxGpio::~JWMatrixLinuxGpio()
+{
+  end();
+}
+
+bool JWMatrixLinuxGpio::begin(const uint8_t *rowPins, uint8_t nRows,
+                              const uint8_t *colPins, uint8_t nCols)
+{
+  end();
+
+  int chipFd = open(_chipPath, O_RDWR | O_CLOEXEC);
+  if (chipFd < 0)
+    return false;
+
+  // Filas: salidas, todas en reposo
+  gpio_v2_line_request rows;
+  memset(&rows, 0, sizeof(rows));
+  for (uint8_t r = 0; r < nRows; r++)
+    rows.offsets[r] = rowPins[r];
+  rows.num_lines = nRows;
+  strncpy(rows.consumer, "jwmb-rows", sizeof(rows.consumer) - 1);
+  rows.config.flags = GPIO_V2_LINE_FLAG_OUTPUT;
+  rows.config.num_attrs = 1;
+  rows.config.attrs[0].attr.id = GPIO_V2_LINE_ATTR_ID_OUTPUT_VALUES;
+  rows.config.attrs[0].attr.values = _rowActiveHigh ? 0 : ((1ull << nRows) - 1);
+  rows.config.attrs[0].mask = (1ull << nRows) - 1;
+
+  // Columnas: entradas con flancos (para dormir en epoll mientras no hay teclas).
+  // Bias al nivel de reposo: pull-down si la fila activa es HIGH, pull-up si es
+  // LOW (así una columna sin tecla no queda flotando)
+  gpio_v2_line_request cols;
+  memset(&cols, 0, sizeof(cols));
+  for (uint8_t c = 0; c < nCols; c++)
+    cols.offsets[c] = colPins[c];
+  cols.num_lines = nCols;
+  strncpy(cols.consumer, "jwmb-cols", sizeof(cols.consumer) - 1);
+  cols.config.flags = GPIO_V2_LINE_FLAG_INPUT |
+                      GPIO_V2_LINE_FLAG_EDGE_RISING |
+                      GPIO_V2_LINE_FLAG_EDGE_FALLING |
+                      (_rowActiveHigh ? GPIO_V2_LINE_FLAG_BIAS_PULL_DOWN
+                                      : GPIO_V2_LINE_FLAG_BIAS_PULL_UP);
+
+  bool ok = (ioctl(chipFd, GPIO_V2_GET_LINE_IOCTL, &rows) == 0) &&
+            (ioctl(chipFd, GPIO_V2_GET_LINE_IOCTL, &cols) == 0);
+  close(chipFd); // los fds de línea siguen válidos sin el del chip
+  if (!ok)
+  {
+    if (rows.fd > 0)
+      close(rows.fd);
+    return false;
+  }
+
+  _rowFd = rows.fd;
+  _colFd = cols.fd;
+  _nRows = nRows;
+  _active = ROW_NONE;
+
+  // Eventos no bloqueantes (para vaciarlos) + epoll para esperar
+  fcntl(_colFd, F_SETFL, fcntl(_colFd, F_GETFL) | O_NONBLOCK);
+  _epFd = epoll_create1(EPOLL_CLOEXEC);
+  if (_epFd < 0)
+  {
+    end();
+    return false;
+  }
+  epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN;
+  ev.data.fd = _colFd;
+  if (epoll_ctl(_epFd, EPOLL_CTL_ADD, _colFd, &ev) != 0)
+  {
+    end();
+    return false;
+  }
+  return true;
+}
+
+void JWMatrixLinuxGpio::end()
+{
+  if (_epFd >= 0)
+    close(_epFd);
+  if (_colFd >= 0)
+    close(_colFd);
+  if (_rowFd >= 0)
+    close(_rowFd);
+  _epFd = _colFd = _rowFd = -1;
+  _nRows = 0;
+  _active = ROW_NONE;
+}
+
+void JWMatrixLinuxGpio::setRows_(uint8_t activeMask)
+{
+  uint64_t all = (1ull << _nRows) - 1;
+  gpio_v2_line_values v;
+  v.mask = all;
+  v.bits = _rowActiveHigh ? activeMask : (~(uint64_t)activeMask & all);
+  ioctl(_rowFd, GPIO_V2_LINE_SET_VALUES_IOCTL, &v);
+}
+
+void JWMatrixLinuxGpio::selectRow(uint8_t row)
+{
+  if (_rowFd < 0 || row == _active)
+    return;
+
+  if (row == ROW_ALL)
+  {
+    setRows_((uint8_t)((1u << _nRows) - 1));
+    // Descartar los flancos que generó el propio escaneo: desde aquí, un
+    // flanco nuevo sí es actividad
+    drainEvents_();
+  }
+  else
+  {
+    setRows_(row < _nRows ? (uint8_t)(1u << row) : 0);
+  }
+  _active = row;
+}
+
+uint8_t JWMatrixLinuxGpio::readCols(uint8_t colMask)
+{
+  if (_colFd < 0)
+    return 0;
+
+  gpio_v2_line_values v;
+  v.mask = colMask;
+  v.bits = 0;
+  if (ioctl(_colFd, GPIO_V2_LINE_GET_VALUES_IOCTL, &v) != 0)
+    return 0;
+  return (uint8_t)(v.bits & colMask);
+}
+
+bool JWMatrixLinuxGpio::waitColEdge(uint32_t timeoutMs)
+{
+  if (_epFd < 0)
+    return true;
+
+  epoll_event ev;
+  int n;
+  do
+  {
+    n = epoll_wait(_epFd, &ev, 1, (int)timeoutMs);
+  } while (n < 0 && errno == EINTR);
+
+  if (n <= 0)
+    return false;
+
+  drainEvents_();
+  return true;
+}
+
+void JWMatrixLinuxGpio::drainEvents_()
+{
+  gpio_v2_line_event buf[16];
+  while (read(_colFd, buf, sizeof(buf)) > 0)
+  {
+  }
+}
+
+#endif
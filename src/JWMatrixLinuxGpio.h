@@ -0,0 +1,55 @@
+#pragma once
+#include "JWMatrixBackend.h"
+
+#if defined(__linux__) && !defined(ARDUINO)
+
+// =========================
+// Backend Linux: GPIO character device (uAPI v2, /dev/gpiochipN)
+// =========================
+// - Filas y columnas se piden en bloque: un request de salidas y uno de entradas
+//   (los pines son offsets de línea del mismo chip).
+// - selectRow(): un ioctl fija todas las filas a la vez.
+// - readCols(): un ioctl lee todas las columnas a la vez.
+// - waitColEdge(): las columnas tienen detección de flancos; bloquea en epoll
+//   sobre el fd de eventos hasta un flanco o timeout (CPU en reposo si no hay teclas).
+//
+// - Columnas con bias al nivel de reposo: pull-down con filas activas en HIGH,
+//   pull-up con filas activas en LOW. invertLogic de begin() debe coincidir:
+//   false con filas en HIGH (tecla = HIGH), true con filas en LOW (tecla = LOW).
+//
+// Uso (filas activas en LOW + pull-up, como el cableado típico en Arduino):
+//   JWMatrixLinuxGpio gpio("/dev/gpiochip0", false);
+//   btn.setBackend(&gpio);
+//   btn.begin(ROWS, 2, COLS, 4, MAP, MAP_LEN, BTN__COUNT, true, 35);
+//   for (;;) { btn.waitForActivity(100); btn.update(); ... }
+class JWMatrixLinuxGpio : public JWMatrixBackend
+{
+public:
+  // rowActiveHigh: nivel de la fila activa (en reposo queda el contrario);
+  // también elige el bias de las columnas (pull-down si true, pull-up si false)
+  explicit JWMatrixLinuxGpio(const char *chipPath = "/dev/gpiochip0",
+                             bool rowActiveHigh = true);
+  ~JWMatrixLinuxGpio() override;
+
+  bool begin(const uint8_t *rowPins, uint8_t nRows,
+             const uint8_t *colPins, uint8_t nCols) override;
+  void end();
+
+  void selectRow(uint8_t row) override;
+  uint8_t readCols(uint8_t colMask) override;
+  bool waitColEdge(uint32_t timeoutMs) override;
+
+private:
+  const char *_chipPath;
+  bool _rowActiveHigh;
+  int _rowFd;
+  int _colFd;
+  int _epFd;
+  uint8_t _nRows;
+  uint8_t _active;
+
+  void setRows_(uint8_t activeMask);
+  void drainEvents_();
+};
+
+#endif
@@ -0,0 +1,60 @@
+#pragma once
+
+// =========================
+// Capa de plataforma
+// =========================
+// En Arduino es solo <Arduino.h>. Fuera de Arduino (ej. HMI con Linux) el núcleo
+// de JWMatrixButtons se compila como C++ portable: aquí se dan millis()/micros()/
+// delay()/delayMicroseconds() sobre POSIX, y el acceso a pines queda en el
+// backend (ver JWMatrixBackend.h).
+//
+// Fuera de Arduino viven en el namespace jwmb (no en el global), para no chocar
+// con otras librerías que definen las suyas (ej. wiringPi). Los .cpp de la
+// librería hacen "using namespace jwmb"; en Arduino el namespace queda vacío y
+// se usan las del core.
+
+#if defined(ARDUINO)
+  #include <Arduino.h>
+
+namespace jwmb
+{
+}
+#else
+  #include <stdint.h>
+  #include <stddef.h>
+  #include <time.h>
+
+namespace jwmb
+{
+
+inline uint32_t millis()
+{
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t)((uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u);
+}
+
+inline uint32_t micros()
+{
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t)((uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u);
+}
+
+inline void delayMicroseconds(uint32_t us)
+{
+  timespec ts;
+  ts.tv_sec = (time_t)(us / 1000000u);
+  ts.tv_nsec = (long)(us % 1000000u) * 1000L;
+  nanosleep(&ts, nullptr);
+}
+
+inline void delay(uint32_t ms)
+{
+  timespec ts;
+  ts.tv_sec = (time_t)(ms / 1000u);
+  ts.tv_nsec = (long)(ms % 1000u) * 1000000L;
+  nanosleep(&ts, nullptr);
+}
+} // namespace jwmb
+#endif
@@ -0,0 +1,241 @@
+#include "JWMatrixTopology.h"
+
+#if defined(ARDUINO)
+
+// =========================
+// JWMatrixPinReader
+// =========================
+
+JWMatrixPinReader::JWMatrixPinReader()
+    : _pins(nullptr), _n(0), _slowPins(0)
+#if JWMB_PORT_READ
+      ,
+      _nPorts(0)
+#endif
+{
+}
+
+bool JWMatrixPinReader::begin(const uint8_t *pins, uint8_t n)
+{
+  if (!pins || n == 0 || n > MAX_PINS)
+    return false;
+
+  _pins = pins;
+  _n = n;
+  _slowPins = 0;
+
+#if JWMB_PORT_READ
+  // Agrupar pines por registro de entrada
+  _nPorts = 0;
+  for (uint8_t i = 0; i < n; i++)
+  {
+    PortReg reg = portInputRegister(digitalPinToPort(pins[i]));
+    uint8_t p = 0;
+    while (p < _nPorts && _reg[p] != reg)
+      p++;
+    if (p == _nPorts)
+    {
+      if (_nPorts >= MAX_PORTS)
+      {
+        _slowPins |= (1ul << i);
+        continue;
+      }
+      _reg[p] = reg;
+      _portPins[p] = 0;
+      _nPorts++;
+    }
+    _portPins[p] |= (1ul << i);
+    _bit[i] = (uint32_t)digitalPinToBitMask(pins[i]);
+  }
+#else
+  _slowPins = (n >= 32) ? 0xFFFFFFFFul : ((1ul << n) - 1u);
+#endif
+  return true;
+}
+
+uint32_t JWMatrixPinReader::read(uint32_t pinMask) const
+{
+  uint32_t bits = 0;
+
+#if JWMB_PORT_READ
+  for (uint8_t p = 0; p < _nPorts; p++)
+  {
+    uint32_t want = pinMask & _portPins[p];
+    if (!want)
+      continue;
+
+    uint32_t v = (uint32_t)*_reg[p]; // una lectura por registro
+    while (want)
+    {
+      uint8_t i = (uint8_t)__builtin_ctzl(want);
+      want &= want - 1;
+      if (v & _bit[i])
+        bits |= (1ul << i);
+    }
+  }
+#endif
+
+  uint32_t slow = pinMask & _slowPins;
+  while (slow)
+  {
+    uint8_t i = (uint8_t)__builtin_ctzl(slow);
+    slow &= slow - 1;
+    if (digitalRead(_pins[i]) == HIGH)
+      bits |= (1ul << i);
+  }
+  return bits;
+}
+
+// =========================
+// JWMatrixDirect
+// =========================
+
+JWMatrixDirect::JWMatrixDirect(const uint8_t *pins, uint8_t nPins, bool pullup)
+    : _pins(pins), _nPins(nPins), _nRows(0), _pullup(pullup), _row(ROW_NONE), _valid(0)
+{
+}
+
+bool JWMatrixDirect::topology(Topology &out) const
+{
+  if (!_pins || _nPins == 0 || _nPins > JWMatrixPinReader::MAX_PINS)
+    return false;
+  out.nRows = (uint8_t)((_nPins + 7u) / 8u);
+  out.nCols = (_nPins < 8) ? _nPins : 8;
+  out.settleUs = 0; // nada que activar
+  out.betweenRowsUs = 0;
+  return true;
+}
+
+bool JWMatrixDirect::begin(const uint8_t *rowPins, uint8_t nRows,
+                           const uint8_t *colPins, uint8_t nCols)
+{
+  (void)rowPins;
+  (void)colPins;
+  Topology t;
+  if (!topology(t) || nRows > t.nRows || nCols > t.nCols)
+    return false;
+  if (!_in.begin(_pins, _nPins))
+    return false;
+
+  for (uint8_t i = 0; i < _nPins; i++)
+    pinMode(_pins[i], _pullup ? INPUT_PULLUP : INPUT);
+
+  _nRows = nRows;
+  _row = ROW_NONE;
+  // La última fila virtual puede quedar incompleta (nPins % 8 != 0)
+  _valid = (_nPins >= 32) ? 0xFFFFFFFFul : ((1ul << _nPins) - 1u);
+  return true;
+}
+
+uint32_t JWMatrixDirect::readPins_(uint32_t want) const
+{
+  // Posiciones sin pin (más allá de nPins): nivel de reposo, nunca "presionada"
+  uint32_t v = _in.read(want & _valid);
+  if (_pullup)
+    v |= want & ~_valid;
+  return v;
+}
+
+void JWMatrixDirect::selectRow(uint8_t row)
+{
+  _row = row; // sin pines que tocar
+}
+
+uint8_t JWMatrixDirect::readCols(uint8_t colMask)
+{
+  // Nivel de reposo (tecla suelta) de los pines que no se leen
+  uint8_t idle = _pullup ? colMask : 0;
+
+  if (_row < _nRows)
+    return (uint8_t)(readPins_((uint32_t)colMask << (8u * _row)) >> (8u * _row));
+
+  if (_row != ROW_ALL)
+    return idle;
+
+  // Todas las filas virtuales a la vez, como una matriz con todas las filas
+  // activas: una tecla activa en cualquier fila marca su columna
+  uint32_t want = 0;
+  for (uint8_t r = 0; r < _nRows; r++)
+    want |= (uint32_t)colMask << (8u * r);
+  uint32_t v = readPins_(want);
+
+  uint8_t bits = idle;
+  for (uint8_t r = 0; r < _nRows; r++)
+  {
+    uint8_t rowBits = (uint8_t)((v >> (8u * r)) & colMask);
+    if (_pullup)
+      bits &= rowBits; // activa en LOW
+    else
+      bits |= rowBits;
+  }
+  return bits;
+}
+
+// =========================
+// JWMatrixCharlieplex
+// =========================
+
+JWMatrixCharlieplex::JWMatrixCharlieplex(const uint8_t *pins, uint8_t nPins)
+    : _pins(pins), _nPins(nPins), _row(ROW_NONE)
+{
+}
+
+bool JWMatrixCharlieplex::topology(Topology &out) const
+{
+  if (!_pins || _nPins < 2 || _nPins > 8)
+    return false;
+  out.nRows = _nPins;
+  out.nCols = _nPins;
+  out.settleUs = 5;      // el pin manejado baja las columnas al instante
+  out.betweenRowsUs = 5; // el pin soltado sube por pull-up
+  return true;
+}
+
+bool JWMatrixCharlieplex::begin(const uint8_t *rowPins, uint8_t nRows,
+                                const uint8_t *colPins, uint8_t nCols)
+{
+  (void)rowPins;
+  (void)colPins;
+  Topology t;
+  if (!topology(t) || nRows > t.nRows || nCols > t.nCols)
+    return false;
+  if (!_in.begin(_pins, _nPins))
+    return false;
+
+  // Reposo: todos entrada con pull-up
+  for (uint8_t i = 0; i < _nPins; i++)
+    pinMode(_pins[i], INPUT_PULLUP);
+  _row = ROW_NONE;
+  return true;
+}
+
+void JWMatrixCharlieplex::selectRow(uint8_t row)
+{
+  // ROW_ALL no existe en charlieplex (un pin en LOW a la vez): queda en reposo
+  if (row >= _nPins)
+    row = ROW_NONE;
+  if (row == _row)
+    return;
+
+  if (_row < _nPins)
+    pinMode(_pins[_row], INPUT_PULLUP);
+  if (row < _nPins)
+  {
+    // LOW antes de pasar a salida: sin pulso en HIGH sobre las teclas
+    digitalWrite(_pins[row], LOW);
+    pinMode(_pins[row], OUTPUT);
+  }
+  _row = row;
+}
+
+uint8_t JWMatrixCharlieplex::readCols(uint8_t colMask)
+{
+  if (_row >= _nPins)
+    return colMask; // reposo: todo en HIGH
+
+  // El pin manejado no es una columna: se reporta suelto (HIGH)
+  uint8_t self = (uint8_t)(colMask & (1u << _row));
+  return (uint8_t)(_in.read((uint32_t)(colMask & ~self)) | self);
+}
+
+#endif
@@ -0,0 +1,118 @@
+#pragma once
+#include "JWMatrixBackend.h"
+
+#if defined(ARDUINO)
+
+// =========================
+// Backends con topología propia: teclas directas y charlieplex
+// =========================
+// Se instalan con setBackend() y se inicializan con
+// JWMatrixButtons::begin(map, mapLen, buttonCount, ...): el backend da las
+// filas/columnas virtuales y los delays de escaneo. Debounce, repeats, latches,
+// grupos y applyAxis() funcionan igual que con una matriz.
+
+// Lectura por puerto: si el core expone los registros de entrada
+// (portInputRegister() y compañía: AVR, ESP32, SAMD, ...), los pines se agrupan
+// por registro y cada registro se lee UNA vez por lectura. Si no, digitalRead().
+#if defined(portInputRegister) && defined(digitalPinToPort) && defined(digitalPinToBitMask)
+  #define JWMB_PORT_READ 1
+#else
+  #define JWMB_PORT_READ 0
+#endif
+
+class JWMatrixPinReader
+{
+public:
+  static const uint8_t MAX_PINS = 32;
+  static const uint8_t MAX_PORTS = 4; // más registros distintos => digitalRead()
+
+  JWMatrixPinReader();
+
+  bool begin(const uint8_t *pins, uint8_t n);
+
+  // bit i = pins[i] en HIGH (solo los bits pedidos en pinMask)
+  uint32_t read(uint32_t pinMask) const;
+
+private:
+  const uint8_t *_pins;
+  uint8_t _n;
+  uint32_t _slowPins; // pines sin registro: digitalRead()
+
+#if JWMB_PORT_READ
+  // Misma expresión que begin(): en algunos cores el puerto es un puntero
+  // (STM32duino: portInputRegister(P) = &(P->IDR)), no un índice
+  typedef decltype(portInputRegister(digitalPinToPort(0))) PortReg;
+
+  PortReg _reg[MAX_PORTS];
+  uint32_t _portPins[MAX_PORTS]; // bit i = pins[i] está en ese registro
+  uint32_t _bit[MAX_PINS];       // máscara de pins[i] dentro de su registro
+  uint8_t _nPorts;
+#endif
+};
+
+// =========================
+// Teclas directas: una tecla por pin
+// =========================
+// - Hasta 32 pines. Tecla i = fila virtual i / 8, columna i % 8 (en el mapa:
+//   {id, i / 8, i % 8}).
+// - No hay filas que activar: selectRow() no toca pines y cada fila virtual se
+//   lee con una lectura por registro de puerto. Sin settle.
+// - pullup = true: INPUT_PULLUP y tecla a GND (activa en LOW => invertLogic=true).
+// - Si nPins no es múltiplo de 8, la última fila virtual queda incompleta: las
+//   posiciones sin pin (i >= nPins) se leen siempre sueltas.
+class JWMatrixDirect : public JWMatrixBackend
+{
+public:
+  JWMatrixDirect(const uint8_t *pins, uint8_t nPins, bool pullup = true);
+
+  bool topology(Topology &out) const override;
+  bool begin(const uint8_t *rowPins, uint8_t nRows,
+             const uint8_t *colPins, uint8_t nCols) override;
+  void selectRow(uint8_t row) override;
+  uint8_t readCols(uint8_t colMask) override;
+
+private:
+  JWMatrixPinReader _in;
+  const uint8_t *_pins;
+  uint8_t _nPins;
+  uint8_t _nRows;
+  bool _pullup;
+  uint8_t _row;    // fila virtual pedida (o ROW_NONE / ROW_ALL)
+  uint32_t _valid; // bit i = posición i tiene pin (i < nPins)
+
+  uint32_t readPins_(uint32_t want) const;
+};
+
+// =========================
+// Charlieplex: n pines, hasta n*(n-1) teclas
+// =========================
+// - 2..8 pines. Tecla (d, s) = fila d, columna s (d != s): al escanear la fila
+//   d solo ese pin se maneja en LOW y los demás se leen con pull-up. Cada tecla
+//   lleva un diodo con el cátodo hacia d.
+// - Los diodos evitan fantasmas entre teclas sin pin en común, no en cadena:
+//   con (d, m) y (m, s) presionadas, s queda a dos caídas de diodo (~1.2-1.4 V)
+//   y en un micro a 5 V se lee LOW => aparece (d, s). A 3.3 V ese nivel cae en
+//   la zona indefinida. Para combinaciones simultáneas usar una matriz.
+// - Por fila: soltar el pin anterior + manejar el nuevo (3 operaciones GPIO) y
+//   una lectura por registro de puerto.
+// - Activa en LOW => invertLogic=true. waitForActivity() no puede activar
+//   todas las "filas" a la vez: vuelve enseguida y se sigue escaneando.
+class JWMatrixCharlieplex : public JWMatrixBackend
+{
+public:
+  JWMatrixCharlieplex(const uint8_t *pins, uint8_t nPins);
+
+  bool topology(Topology &out) const override;
+  bool begin(const uint8_t *rowPins, uint8_t nRows,
+             const uint8_t *colPins, uint8_t nCols) override;
+  void selectRow(uint8_t row) override;
+  uint8_t readCols(uint8_t colMask) override;
+
+private:
+  JWMatrixPinReader _in;
+  const uint8_t *_pins;
+  uint8_t _nPins;
+  uint8_t _row; // pin manejado en LOW (o ROW_NONE)
+};
+
+#endif